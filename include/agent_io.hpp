@@ -2,10 +2,17 @@
 #include "fstream"
 #include "network.hpp"
 #include "util/misc.hpp"
+#include "util/parallel.hpp"
+#include <fmt/compile.h>
 #include <fmt/core.h>
 #include <fmt/format.h>
 #include <fmt/ostream.h>
 #include <fmt/ranges.h>
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace Seldon
@@ -17,14 +24,38 @@ template<typename AgentT>
     return "";
 }
 
+/*
+Appends the columns of an agent (see agent_to_string_column_names) to buffer, which is what agents_to_file writes.
+By default this appends agent_to_string, agent types specialise it to be written without allocating
+*/
+template<typename AgentT>
+void format_agent_to( fmt::memory_buffer & buffer, const AgentT & agent )
+{
+    const auto str = agent_to_string( agent );
+    buffer.append( str.data(), str.data() + str.size() );
+}
+
+// agent_to_string for agent types that specialise format_agent_to
+template<typename AgentT>
+[[nodiscard]] std::string format_agent( const AgentT & agent )
+{
+    fmt::memory_buffer buffer{};
+    format_agent_to( buffer, agent );
+    return fmt::to_string( buffer );
+}
+
 template<typename AgentT>
 [[nodiscard]] std::string opinion_to_string( const AgentT & agent [[maybe_unused]] )
 {
     return fmt::format( "{}", agent.data.opinion );
 }
 
+/*
+Reads an agent from the columns that follow the index of the agent in a line of an agents file, which
+agents_from_file passes without copying the line. A std::string or a string literal converts to the std::string_view
+*/
 template<typename AgentT>
-[[nodiscard]] AgentT agent_from_string( const std::string & str [[maybe_unused]] )
+[[nodiscard]] AgentT agent_from_string( std::string_view str [[maybe_unused]] )
 {
     return AgentT{};
 }
@@ -35,14 +66,9 @@ template<typename AgentT>
     return { "agent_data[...]" };
 }
 
-template<typename AgentT>
-void agents_to_file( const Network<AgentT> & network, const std::string & file_path )
+template<typename AgentT, typename WeightT, typename IndexT>
+void agents_to_file( const Network<AgentT, WeightT, IndexT> & network, const std::string & file_path )
 {
-    std::fstream fs;
-    fs.open( file_path, std::fstream::in | std::fstream::out | std::fstream::trunc );
-
-    size_t n_agents = network.n_agents();
-
     auto column_names = agent_to_string_column_names<AgentT>();
 
     std::string header = "# idx_agent";
@@ -52,52 +78,58 @@ void agents_to_file( const Network<AgentT> & network, const std::string & file_p
     }
     header += "\n";
 
-    fmt::print( fs, "{}", header );
-    for( size_t idx_agent = 0; idx_agent < n_agents; idx_agent++ )
+    // The agents are written in their original order (see Network::permute_agents)
+    auto format_rows = [&]( fmt::memory_buffer & buffer, size_t idx_begin, size_t idx_end )
     {
-        std::string row = fmt::format( "{:>5}, {:>25}\n", idx_agent, agent_to_string( network.agents[idx_agent] ) );
-        fs << row;
-    }
-    fs.close();
+        // The agent is right aligned as a whole, so it is formatted into a scratch buffer first
+        fmt::memory_buffer agent_buffer{};
+        for( size_t idx_original = idx_begin; idx_original < idx_end; idx_original++ )
+        {
+            agent_buffer.clear();
+            format_agent_to( agent_buffer, network.agents[network.agent_index( idx_original )] );
+            fmt::format_to(
+                std::back_inserter( buffer ), FMT_COMPILE( "{:>5}, {:>25}\n" ), idx_original,
+                fmt::string_view( agent_buffer.data(), agent_buffer.size() ) );
+        }
+    };
+
+    write_rows_to_file( file_path, header, network.n_agents(), format_rows );
 }
 
+/*
+Reads agents from a file with one line per agent, which starts with the index of the agent followed by the columns
+parsed by agent_from_string. Lines starting with '#' are comments and an empty line ends the data.
+The lines are parsed in parallel, in line-aligned chunks
+*/
 template<typename AgentT>
 std::vector<AgentT> agents_from_file( const std::string & file )
 {
-    std::vector<AgentT> agents{};
-
-    std::string file_contents = get_file_contents( file );
-    bool finished             = false;
-    size_t start_of_line      = 0;
-
-    while( !finished )
+    auto parse_agent = []( std::string_view line, std::vector<AgentT> & agents )
     {
-        // Find the end of the current line
-        auto end_of_line = file_contents.find( '\n', start_of_line );
-        if( end_of_line == std::string::npos )
-        {
-            finished = true;
-        }
-        // Get the current line as a substring
-        auto line     = file_contents.substr( start_of_line, end_of_line - start_of_line );
-        start_of_line = end_of_line + 1;
-
-        if( line.empty() )
-        {
-            break;
-        }
-        if( line[0] == '#' )
-        {
-            continue;
-        }
-
-        // First column is the index of the agent
-        auto end_of_first_column = line.find( ',', 0 );
-        auto opinion_substring   = line.substr( end_of_first_column + 1, end_of_line );
-
-        agents.push_back( agent_from_string<AgentT>( opinion_substring ) );
+        // First column is the index of the agent. Lines without a comma are passed on whole, since npos + 1 is 0
+        const auto end_of_first_column = line.find( ',' );
+        agents.push_back( agent_from_string<AgentT>( line.substr( end_of_first_column + 1 ) ) );
+    };
+
+    const MappedFile file_mapping( file );
+    const auto bytes = file_mapping.contents();
+    auto chunks
+        = parse_lines_in_parallel<std::vector<AgentT>>( std::string_view( bytes.data(), bytes.size() ), parse_agent );
+
+    // Stitch the agents of the chunks together, in order
+    std::vector<size_t> chunk_begin( chunks.size() + 1, 0 );
+    for( size_t idx_chunk = 0; idx_chunk < chunks.size(); idx_chunk++ )
+    {
+        chunk_begin[idx_chunk + 1] = chunk_begin[idx_chunk] + chunks[idx_chunk].size();
     }
 
+    std::vector<AgentT> agents( chunk_begin.back() );
+    auto move_chunk = [&]( size_t idx_chunk )
+    {
+        std::move( chunks[idx_chunk].begin(), chunks[idx_chunk].end(), agents.begin() + chunk_begin[idx_chunk] );
+    };
+    Parallel::for_each_index( chunks.size(), move_chunk, 1 );
+
     return agents;
 }
 
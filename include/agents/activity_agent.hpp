@@ -15,10 +15,18 @@ struct ActivityAgentData
 
 using ActivityAgent = Agent<ActivityAgentData>;
 
+template<>
+inline void format_agent_to<ActivityAgent>( fmt::memory_buffer & buffer, const ActivityAgent & agent )
+{
+    fmt::format_to(
+        std::back_inserter( buffer ), FMT_COMPILE( "{}, {}, {}" ), agent.data.opinion, agent.data.activity,
+        agent.data.reluctance );
+}
+
 template<>
 inline std::string agent_to_string<ActivityAgent>( const ActivityAgent & agent )
 {
-    return fmt::format( "{}, {}, {}", agent.data.opinion, agent.data.activity, agent.data.reluctance );
+    return format_agent( agent );
 }
 
 template<>
@@ -28,27 +36,34 @@ inline std::string opinion_to_string<ActivityAgent>( const ActivityAgent & agent
 }
 
 template<>
-inline ActivityAgent agent_from_string<ActivityAgent>( const std::string & str )
+inline ActivityAgent agent_from_string<ActivityAgent>( std::string_view str )
 {
     ActivityAgent res{};
 
-    auto pos_comma      = str.find_first_of( ',' );
-    auto pos_next_comma = str.find( ',', pos_comma + 1 );
-
-    res.data.opinion = std::stod( str.substr( 0, pos_comma ) );
-
-    if( pos_next_comma == std::string::npos )
-    {
-        res.data.activity = std::stod( str.substr( pos_comma + 1, str.size() ) );
-    }
-    else
+    size_t n_columns = 0;
+    auto callback    = [&]( size_t idx_list, std::string_view substr )
     {
-        res.data.activity = std::stod( str.substr( pos_comma + 1, pos_next_comma ) );
-    }
+        n_columns++;
+        if( idx_list == 0 )
+        {
+            res.data.opinion = parse_number<double>( substr );
+        }
+        else if( idx_list == 1 )
+        {
+            res.data.activity = parse_number<double>( substr );
+        }
+        else if( idx_list == 2 )
+        {
+            res.data.reluctance = parse_number<double>( substr );
+        }
+    };
+
+    for_each_column( str, callback );
 
-    if( pos_next_comma != std::string::npos )
+    // A line with only an opinion sets the activity to the same value, so that existing files are read as before
+    if( n_columns == 1 )
     {
-        res.data.reluctance = std::stod( str.substr( pos_next_comma + 1, str.size() ) );
+        res.data.activity = res.data.opinion;
     }
 
     return res;
@@ -2,6 +2,7 @@
 
 #include "agent.hpp"
 #include "agent_io.hpp"
+#include "util/memory.hpp"
 #include "util/misc.hpp"
 #include <cstddef>
 #include <string>
@@ -18,17 +19,22 @@ struct DiscreteVectorAgentData
 using DiscreteVectorAgent = Agent<DiscreteVectorAgentData>;
 
 template<>
-inline std::string agent_to_string<DiscreteVectorAgent>( const DiscreteVectorAgent & agent )
+inline void format_agent_to<DiscreteVectorAgent>( fmt::memory_buffer & buffer, const DiscreteVectorAgent & agent )
 {
     if( agent.data.opinion.empty() )
-        return "";
+        return;
 
-    auto res = fmt::format( "{}", agent.data.opinion[0] );
+    fmt::format_to( std::back_inserter( buffer ), FMT_COMPILE( "{}" ), agent.data.opinion[0] );
     for( size_t i = 1; i < agent.data.opinion.size(); i++ )
     {
-        res += fmt::format( ", {}", agent.data.opinion[i] );
+        fmt::format_to( std::back_inserter( buffer ), FMT_COMPILE( ", {}" ), agent.data.opinion[i] );
     }
-    return res;
+}
+
+template<>
+inline std::string agent_to_string<DiscreteVectorAgent>( const DiscreteVectorAgent & agent )
+{
+    return format_agent( agent );
 }
 
 template<>
@@ -38,14 +44,20 @@ inline std::string opinion_to_string<DiscreteVectorAgent>( const DiscreteVectorA
 }
 
 template<>
-inline DiscreteVectorAgent agent_from_string<DiscreteVectorAgent>( const std::string & str )
+inline std::pair<size_t, size_t> owned_memory<DiscreteVectorAgent>( const DiscreteVectorAgent & agent )
+{
+    return { agent.data.opinion.size() * sizeof( int ), agent.data.opinion.capacity() * sizeof( int ) };
+}
+
+template<>
+inline DiscreteVectorAgent agent_from_string<DiscreteVectorAgent>( std::string_view str )
 {
     DiscreteVectorAgent res{};
 
-    auto callback = [&]( int idx_list [[maybe_unused]], const auto & substring )
-    { res.data.opinion.push_back( std::stoi( substring ) ); };
+    auto callback = [&]( size_t idx_list [[maybe_unused]], std::string_view substring )
+    { res.data.opinion.push_back( parse_number<int>( substring ) ); };
 
-    parse_comma_separated_list( str, callback );
+    for_each_column( str, callback );
     return res;
 };
 
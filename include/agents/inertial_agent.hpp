@@ -17,11 +17,18 @@ struct InertialAgentData
 
 using InertialAgent = Agent<InertialAgentData>;
 
+template<>
+inline void format_agent_to<InertialAgent>( fmt::memory_buffer & buffer, const InertialAgent & agent )
+{
+    fmt::format_to(
+        std::back_inserter( buffer ), FMT_COMPILE( "{}, {}, {}, {}" ), agent.data.opinion, agent.data.velocity,
+        agent.data.activity, agent.data.reluctance );
+}
+
 template<>
 inline std::string agent_to_string<InertialAgent>( const InertialAgent & agent )
 {
-    return fmt::format(
-        "{}, {}, {}, {}", agent.data.opinion, agent.data.velocity, agent.data.activity, agent.data.reluctance );
+    return format_agent( agent );
 }
 
 template<>
@@ -31,31 +38,31 @@ inline std::string opinion_to_string<InertialAgent>( const InertialAgent & agent
 }
 
 template<>
-inline InertialAgent agent_from_string<InertialAgent>( const std::string & str )
+inline InertialAgent agent_from_string<InertialAgent>( std::string_view str )
 {
     InertialAgent res{};
 
-    auto callback = [&]( int idx_list, std::string & substr )
+    auto callback = [&]( size_t idx_list, std::string_view substr )
     {
         if( idx_list == 0 )
         {
-            res.data.opinion = std::stod( substr );
+            res.data.opinion = parse_number<double>( substr );
         }
         else if( idx_list == 1 )
         {
-            res.data.velocity = std::stod( substr );
+            res.data.velocity = parse_number<double>( substr );
         }
         else if( idx_list == 2 )
         {
-            res.data.activity = std::stod( substr );
+            res.data.activity = parse_number<double>( substr );
         }
         else if( idx_list == 3 )
         {
-            res.data.reluctance = std::stod( substr );
+            res.data.reluctance = parse_number<double>( substr );
         }
     };
 
-    Seldon::parse_comma_separated_list( str, callback );
+    Seldon::for_each_column( str, callback );
 
     return res;
 };
@@ -13,10 +13,16 @@ struct SimpleAgentData
 
 using SimpleAgent = Agent<SimpleAgentData>;
 
+template<>
+inline void format_agent_to<SimpleAgent>( fmt::memory_buffer & buffer, const SimpleAgent & agent )
+{
+    fmt::format_to( std::back_inserter( buffer ), FMT_COMPILE( "{}" ), agent.data.opinion );
+}
+
 template<>
 inline std::string agent_to_string<SimpleAgent>( const SimpleAgent & agent )
 {
-    return fmt::format( "{}", agent.data.opinion );
+    return format_agent( agent );
 }
 
 template<>
@@ -26,10 +32,10 @@ inline std::string opinion_to_string<SimpleAgent>( const SimpleAgent & agent )
 }
 
 template<>
-inline SimpleAgent agent_from_string<SimpleAgent>( const std::string & str )
+inline SimpleAgent agent_from_string<SimpleAgent>( std::string_view str )
 {
     SimpleAgent res{};
-    res.data.opinion = std::stod( str );
+    res.data.opinion = parse_number<double>( str );
     return res;
 }
 
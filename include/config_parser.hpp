@@ -5,6 +5,7 @@
 #include <cstddef>
 #include <optional>
 #include <random>
+#include <string>
 #include <string_view>
 #include <variant>
 #include <vector>
@@ -36,6 +37,8 @@ struct OutputSettings
     std::optional<size_t> n_output_network = std::nullopt;
     bool print_progress                    = false; // Print the iteration time, by default does not print
     bool output_initial                    = true;  // Output initial opinions and network, by default always outputs.
+    bool output_connectivity               = false; // Write the connectivity of the network of every iteration
+    bool binary_network                    = false; // Write the networks in the binary format, which -n can load
     size_t start_output         = 1; // Start printing opinion and/or network files from this iteration number
     size_t start_numbering_from = 0; // The initial step number, before the simulation runs, is this value. The first
                                      // step would be (1+start_numbering_from). By default, 0
@@ -52,9 +55,13 @@ struct DeffuantSettings
     std::optional<int> max_iterations = std::nullopt;
     double homophily_threshold
         = 0.2;                      // d in the paper; agents interact if difference in opinion is less than this value
-    double mu              = 0.5;   // convergence parameter; similar to social interaction strength K (0,0.5]
-    bool use_network       = false; // For using a square lattice network
-    bool use_binary_vector = false; // For the multi-dimensional DeffuantModelVector; by default set to false
+    double mu                   = 0.5;   // convergence parameter; similar to social interaction strength K (0,0.5]
+    bool use_network            = false; // For using a square lattice network
+    size_t lattice_dim          = 2;     // The number of dimensions of the lattice
+    size_t lattice_radius       = 1;     // The distance up to which the sites of the lattice are neighbours
+    bool moore_neighbourhood    = false; // Measure the distance with the maximum norm, instead of the L1 norm
+    double rewiring_probability = 0.0;   // Probability to rewire every edge of the lattice (small-world network)
+    bool use_binary_vector      = false; // For the multi-dimensional DeffuantModelVector; by default set to false
     size_t dim
         = 1; // The size of the opinions vector. This is used for the multi-dimensional DeffuantModelVector model.
 };
@@ -92,8 +99,22 @@ struct ActivityDrivenInertialSettings : public ActivityDrivenSettings
 struct InitialNetworkSettings
 {
     std::optional<std::string> file;
+    // How the network is generated, if it is not read from a file: "n_connections" (every agent draws n_connections
+    // neighbours), "barabasi_albert" (scale-free, every new agent attaches to n_connections agents) or
+    // "stochastic_block_model" (see block_sizes and block_probabilities)
+    std::string type     = "n_connections";
     size_t n_agents      = 200;
     size_t n_connections = 10;
+    // Stochastic block model: the sizes of the blocks, which replace n_agents, and the probability
+    // block_probabilities[a][b] that an agent in block a has an incoming edge from an agent in block b
+    std::vector<size_t> block_sizes{};
+    std::vector<std::vector<double>> block_probabilities{};
+    bool use_csr         = false; // Store the edges in compressed sparse row format, instead of adjacency lists
+    // Generate the network in parallel with one RNG stream per agent. For a given seed, the network then differs from
+    // the one generated serially
+    bool parallel_generation = false;
+    // Relabel the agents to improve the memory locality: "none", "bfs", "rcm" (reverse Cuthill-McKee) or "degree"
+    std::string ordering = "none";
 };
 
 struct SimulationOptions
@@ -102,7 +123,8 @@ struct SimulationOptions
         = std::variant<DeGrootSettings, ActivityDrivenSettings, ActivityDrivenInertialSettings, DeffuantSettings>;
     Model model;
     std::string model_string;
-    int rng_seed = std::random_device()();
+    int rng_seed     = std::random_device()();
+    size_t n_threads = 0; // Number of threads used by the parallel algorithms, 0 means all hardware threads
     OutputSettings output_settings;
     ModelVariantT model_settings;
     InitialNetworkSettings network_settings;
@@ -1,123 +1,1069 @@
 #pragma once
+#include "util/memory.hpp"
+#include "util/parallel.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
-#include <tuple>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace Seldon
 {
 
+/*
+    A list of components (sets of vertices), stored in one flat array.
+    The vertices of component i are vertices[offsets[i]], ..., vertices[offsets[i+1]-1]
+*/
+template<typename IndexT = size_t>
+struct ComponentList
+{
+    std::vector<size_t> offsets{ 0 };
+    std::vector<IndexT> vertices{};
+
+    /*
+    Gives the (sorted) components, where representative[v] is any vertex of the component of vertex v that is the
+    same for all vertices of the component
+    */
+    [[nodiscard]] static ComponentList from_representatives( const std::vector<IndexT> & representative )
+    {
+        const size_t n_vertices = representative.size();
+
+        // The components are numbered in the order of their smallest vertex
+        constexpr IndexT unnumbered = std::numeric_limits<IndexT>::max();
+        std::vector<IndexT> component_number( n_vertices, unnumbered );
+        std::vector<size_t> component_size{};
+        for( size_t v = 0; v < n_vertices; v++ )
+        {
+            const size_t root = representative[v];
+            if( component_number[root] == unnumbered )
+            {
+                component_number[root] = IndexT( component_size.size() );
+                component_size.push_back( 0 );
+            }
+            component_size[component_number[root]]++;
+        }
+
+        ComponentList components{};
+        components.offsets.resize( component_size.size() + 1 );
+        std::inclusive_scan( component_size.begin(), component_size.end(), components.offsets.begin() + 1 );
+        components.vertices.resize( n_vertices );
+        std::vector<size_t> position( components.offsets.begin(), components.offsets.end() - 1 );
+        for( size_t v = 0; v < n_vertices; v++ )
+        {
+            components.vertices[position[component_number[representative[v]]]++] = IndexT( v );
+        }
+        return components;
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return offsets.size() - 1;
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return size() == 0;
+    }
+
+    [[nodiscard]] std::span<const IndexT> operator[]( size_t idx_component ) const
+    {
+        return std::span<const IndexT>(
+            vertices.data() + offsets[idx_component], offsets[idx_component + 1] - offsets[idx_component] );
+    }
+
+    /*
+    Gives every component as its own vector
+    */
+    [[nodiscard]] std::vector<std::vector<IndexT>> to_nested() const
+    {
+        std::vector<std::vector<IndexT>> nested( size() );
+        for( size_t idx_component = 0; idx_component < size(); idx_component++ )
+        {
+            auto component = ( *this )[idx_component];
+            nested[idx_component].assign( component.begin(), component.end() );
+        }
+        return nested;
+    }
+
+    /*
+    Sorts the vertices within every component and the components by their smallest vertex.
+    Algorithms that find the same components in a different order give the same list after sorting
+    */
+    void sort()
+    {
+        for( size_t idx_component = 0; idx_component < size(); idx_component++ )
+        {
+            std::sort( vertices.begin() + offsets[idx_component], vertices.begin() + offsets[idx_component + 1] );
+        }
+
+        std::vector<size_t> order( size() );
+        std::iota( order.begin(), order.end(), 0 );
+        std::sort(
+            order.begin(), order.end(),
+            [&]( size_t i1, size_t i2 ) { return vertices[offsets[i1]] < vertices[offsets[i2]]; } );
+
+        ComponentList sorted{};
+        sorted.vertices.reserve( vertices.size() );
+        for( const auto & idx_component : order )
+        {
+            auto component = ( *this )[idx_component];
+            sorted.vertices.insert( sorted.vertices.end(), component.begin(), component.end() );
+            sorted.offsets.push_back( sorted.vertices.size() );
+        }
+        *this = std::move( sorted );
+    }
+
+    bool operator==( const ComponentList & other ) const = default;
+};
+
+/*
+    Tarjan's algorithm for the strongly connected components of a graph.
+    IndexT is the integer type of the vertex indices.
+    The depth-first search is iterative, with an explicit stack, so that long paths can not overflow the call stack.
+    The bookkeeping per vertex is two IndexT and one bit. The components are found in reverse topological order
+*/
+template<typename IndexT = size_t>
 class TarjanConnectivityAlgo
 {
 public:
-    TarjanConnectivityAlgo( const std::vector<std::vector<size_t>> & adjacency_list_arg )
-            : scc_list( std::vector<std::vector<size_t>>( 0 ) ),
-              adjacency_list( adjacency_list_arg ),
-              num_nodes( adjacency_list.size() ),
-              num( std::vector<size_t>( num_nodes ) ),
-              lowest( std::vector<size_t>( num_nodes ) ),
-              visited( std::vector<bool>( num_nodes, false ) ),
-              processed( std::vector<bool>( num_nodes, false ) ),
-              stack( std::vector<size_t>( 0 ) ),
-              index_counter( 0 )
+    /*
+    get_neighbours( v ) has to give a view (e.g. a std::span) into the neighbours of vertex v,
+    which has to stay valid while the algorithm runs. The neighbours are not copied
+    */
+    template<typename NeighbourFunctionT>
+    TarjanConnectivityAlgo( size_t n_vertices, NeighbourFunctionT && get_neighbours )
+            : num_nodes( n_vertices ),
+              num( std::vector<IndexT>( num_nodes, unvisited ) ),
+              lowest( std::vector<IndexT>( num_nodes ) ),
+              on_stack( std::vector<bool>( num_nodes, false ) )
     {
-        run(); // Tarjan's algorithm
+        components.vertices.reserve( num_nodes );
+        run( get_neighbours ); // Tarjan's algorithm
     }
 
-    std::vector<std::vector<size_t>>
-        scc_list; // Each element is a vector of indices corresponding to a strongly connected component (SCC)
+    TarjanConnectivityAlgo( const std::vector<std::vector<IndexT>> & adjacency_list )
+            : TarjanConnectivityAlgo(
+                  adjacency_list.size(),
+                  [&]( size_t v ) { return std::span<const IndexT>( adjacency_list[v] ); } )
+    {
+    }
+
+    ComponentList<IndexT> components{}; // The strongly connected components (SCCs)
 
 private:
-    std::vector<std::vector<size_t>> adjacency_list;
+    static constexpr IndexT unvisited = std::numeric_limits<IndexT>::max();
+
     size_t num_nodes;
-    std::vector<size_t> num;     // holding vertex numbers
-    std::vector<size_t> lowest;  // lowest[v] : minimum number of a vertex reachable from v
-    std::vector<bool> visited;   // visited so DFS has seen these vertices (not necessarily processed)
-    std::vector<bool> processed; // vertices which have been processed by DFS
-    std::vector<size_t>
+    std::vector<IndexT> num;    // holding vertex numbers, unvisited for vertices the DFS has not seen yet
+    std::vector<IndexT> lowest; // lowest[v] : minimum number of a vertex reachable from v
+    std::vector<bool> on_stack; // vertices on the stack, i.e. in a component that has not been completed
+    std::vector<IndexT>
         stack; // stack of vertices to keep a working set of vertices. Holds all vertices reachable from the starting vertex
-    size_t index_counter; // depth-first search node number counter
+    IndexT index_counter = 0; // depth-first search node number counter
 
-    // Depth-first search
-    // v: Current vertex
-    void depth_first_search( std::size_t v )
+    // Actually run Tarjan's algorithm
+    // for finding strongly connected components (SCCs)
+    template<typename NeighbourFunctionT>
+    void run( NeighbourFunctionT & get_neighbours )
     {
-        std::vector<size_t> scc;
+        using NeighboursT = std::decay_t<decltype( get_neighbours( size_t( 0 ) ) )>;
 
-        // Set things for the current vertex v
-        num[v]    = index_counter;
-        lowest[v] = num[v];
-        index_counter += 1;
-        visited[v] = true;
-        stack.push_back( v );
+        // A frame of the depth-first search: the vertex and the position of the next neighbour to look at
+        struct Frame
+        {
+            NeighboursT neighbours;
+            size_t idx_neighbour;
+            IndexT v;
+        };
+        std::vector<Frame> dfs_stack{};
 
-        // Loop through neighbours of v
-        // u is the neighbouring vertex
-        for( auto & u : adjacency_list[v] )
+        auto visit = [&]( size_t v )
         {
-            // Skip for the element itself
-            if( u == v )
+            num[v]    = index_counter;
+            lowest[v] = index_counter;
+            index_counter++;
+            stack.push_back( IndexT( v ) );
+            on_stack[v] = true;
+            dfs_stack.push_back( Frame{ get_neighbours( v ), 0, IndexT( v ) } );
+        };
+
+        // Tarjan's algorithm takes the form of a series of DFS invocations
+        for( size_t i_node = 0; i_node < num_nodes; ++i_node )
+        {
+            // Start from a node that has not been visited
+            if( num[i_node] != unvisited )
             {
                 continue;
             }
 
-            // If u hasn't been visited do a DFS
-            if( !visited[u] )
+            visit( i_node );
+            while( !dfs_stack.empty() )
             {
-                // recursive call to DFS
-                depth_first_search( u );
-                lowest[v] = std::min( lowest[v], lowest[u] );
-            } // u not visited
-            else
+                auto & frame   = dfs_stack.back();
+                const IndexT v = frame.v;
+
+                // Look at the next neighbour u of v
+                if( frame.idx_neighbour < frame.neighbours.size() )
+                {
+                    const size_t u = frame.neighbours[frame.idx_neighbour];
+                    frame.idx_neighbour++;
+
+                    if( num[u] == unvisited )
+                    {
+                        visit( u ); // Invalidates frame
+                    }
+                    else if( on_stack[u] )
+                    {
+                        // u belongs to the component that is currently being built
+                        lowest[v] = std::min( lowest[v], num[u] );
+                    }
+                    continue;
+                }
+
+                // All neighbours of v have been processed
+                dfs_stack.pop_back();
+                if( !dfs_stack.empty() )
+                {
+                    const IndexT parent = dfs_stack.back().v;
+                    lowest[parent]      = std::min( lowest[parent], lowest[v] );
+                }
+
+                // Handle SCC if found, by unravelling the stack down to v
+                if( lowest[v] == num[v] )
+                {
+                    IndexT scc_vertex = 0;
+                    do
+                    {
+                        scc_vertex = stack.back();
+                        stack.pop_back();
+                        on_stack[scc_vertex] = false;
+                        components.vertices.push_back( scc_vertex );
+                    } while( scc_vertex != v );
+                    components.offsets.push_back( components.vertices.size() );
+                }
+            }
+        }
+    }
+};
+
+/*
+    A parallel algorithm for the strongly connected components of a graph, which finds the same components as
+    TarjanConnectivityAlgo. It combines the following steps (see e.g. Slota et al., "BFS and coloring-based parallel
+    algorithms for strongly connected components and related problems", 2014):
+        1. Trimming: vertices without incoming or outgoing edges (to vertices that are not assigned to a component
+           yet) are components of their own. Removing them can make further vertices trivial.
+        2. Forward-backward: the component of a pivot vertex with many edges, which usually is the giant component,
+           consists of the vertices that are reachable from the pivot and from which the pivot is reachable.
+        3. Colouring: every vertex takes the largest index of all vertices it can be reached from. A vertex that
+           keeps its own index is the root of a component, which consists of the vertices with the same colour
+           that can reach the root. This is repeated (with trimming) for the remaining vertices.
+        4. Once only a few vertices remain, they are handed to TarjanConnectivityAlgo.
+    The components are sorted (see ComponentList::sort), so that the result does not depend on the number of threads.
+    n_threads is the number of threads used (if not set, see Parallel::get_n_threads)
+*/
+template<typename IndexT = size_t>
+class ParallelConnectivityAlgo
+{
+public:
+    /*
+    get_neighbours( v ) has to give a view (e.g. a std::span) into the neighbours of vertex v, which has to stay
+    valid while the algorithm runs. It is called from several threads at the same time
+    */
+    template<typename NeighbourFunctionT>
+    ParallelConnectivityAlgo(
+        size_t n_vertices, NeighbourFunctionT && get_neighbours, std::optional<size_t> n_threads = std::nullopt )
+            : num_nodes( n_vertices ),
+              n_threads( n_threads ),
+              in_degree( std::vector<std::atomic<size_t>>( num_nodes ) ),
+              out_degree( std::vector<std::atomic<size_t>>( num_nodes ) ),
+              assigned( std::vector<std::atomic<bool>>( num_nodes ) ),
+              component( std::vector<IndexT>( num_nodes ) )
+    {
+        run( get_neighbours );
+    }
+
+    ComponentList<IndexT> components{}; // The strongly connected components (SCCs)
+
+private:
+    // Atomic operations that only need to be atomic, i.e. which do not order other memory accesses
+    static constexpr auto relaxed = std::memory_order_relaxed;
+
+    // Below this many remaining vertices, Tarjan's algorithm is faster than another round of colouring
+    static constexpr size_t serial_threshold = Parallel::default_min_chunk_size;
+
+    size_t num_nodes;
+    std::optional<size_t> n_threads;
+    std::vector<size_t> in_offsets{};            // The incoming edges, in CSR format
+    std::vector<IndexT> in_neighbours{};         // (without self-loops)
+    std::vector<std::atomic<size_t>> in_degree;  // incoming edges from vertices which are not assigned yet
+    std::vector<std::atomic<size_t>> out_degree; // outgoing edges to vertices which are not assigned yet
+    std::vector<std::atomic<bool>> assigned;     // vertices that belong to a component that has been found
+    std::vector<IndexT> component;               // component[v] : a vertex of the component of v, once assigned
+    std::vector<std::atomic<IndexT>> colour{};   // The colour of every remaining vertex in colour_remaining
+    std::vector<std::atomic<bool>> queued{};     // remaining vertices in the frontier of colour_remaining
+    std::vector<std::atomic<bool>> reachable{};  // vertices reachable from the pivot in forward_backward
+
+    [[nodiscard]] std::span<const IndexT> get_in_neighbours( size_t v ) const
+    {
+        return std::span<const IndexT>( in_neighbours.data() + in_offsets[v], in_offsets[v + 1] - in_offsets[v] );
+    }
+
+    // Assigns v to the component of root, unless another thread got there first
+    bool claim( size_t v, size_t root )
+    {
+        // Test before the exchange, which is more expensive
+        if( assigned[v].load( relaxed ) || assigned[v].exchange( true, relaxed ) )
+        {
+            return false;
+        }
+        component[v] = IndexT( root );
+        return true;
+    }
+
+    /*
+    Calls func( idx, push ) for every idx in [0, n) in parallel and gives all vertices passed to push( v ).
+    The vertices pushed for smaller idx come first. Most rounds of the searches have small frontiers, which fit into
+    one chunk: these run on the calling thread, without starting threads or buffering per chunk
+    */
+    template<typename FuncT>
+    std::vector<IndexT> parallel_collect( size_t n, FuncT && func ) const
+    {
+        const size_t n_chunk = Parallel::n_chunks( n, Parallel::default_min_chunk_size, n_threads );
+        if( n_chunk == 1 )
+        {
+            std::vector<IndexT> collected{};
+            auto push = [&]( size_t v ) { collected.push_back( IndexT( v ) ); };
+            for( size_t idx = 0; idx < n; idx++ )
             {
-                // If u has been processed, then it is a cross-edge and should be ignored.
-                // If u has been visited but not processed:
-                if( !processed[u] )
+                func( idx, push );
+            }
+            return collected;
+        }
+
+        std::vector<std::vector<IndexT>> collected_per_chunk( n_chunk );
+
+        Parallel::for_each_chunk(
+            n,
+            [&]( size_t idx_begin, size_t idx_end, size_t idx_chunk )
+            {
+                auto & collected = collected_per_chunk[idx_chunk];
+                auto push        = [&]( size_t v ) { collected.push_back( IndexT( v ) ); };
+                for( size_t idx = idx_begin; idx < idx_end; idx++ )
                 {
-                    lowest[v] = std::min( lowest[v], num[u] );
-                } // u not processed
-            } // u has been visited
+                    func( idx, push );
+                }
+            },
+            Parallel::default_min_chunk_size, n_threads );
+
+        std::vector<IndexT> collected{};
+        for( const auto & collected_chunk : collected_per_chunk )
+        {
+            collected.insert( collected.end(), collected_chunk.begin(), collected_chunk.end() );
         }
+        return collected;
+    }
 
-        // Now v has been processed
-        processed[v] = true;
+    // Counts the edges of every vertex and transposes the graph
+    template<typename NeighbourFunctionT>
+    void build_incoming_edges( NeighbourFunctionT & get_neighbours )
+    {
+        Parallel::for_each_index(
+            num_nodes,
+            [&]( size_t v )
+            {
+                size_t n_out = 0;
+                for( const auto & u : get_neighbours( v ) )
+                {
+                    if( u != v )
+                    {
+                        in_degree[u].fetch_add( 1, relaxed );
+                        n_out++;
+                    }
+                }
+                out_degree[v].store( n_out, relaxed );
+            },
+            Parallel::default_min_chunk_size, n_threads );
 
-        // Handle SCC if found
-        if( lowest[v] == num[v] )
+        in_offsets.resize( num_nodes + 1 );
+        in_offsets[0] = 0;
+        for( size_t v = 0; v < num_nodes; v++ )
         {
-            scc.resize( 0 );
-            size_t scc_vertex = 0;
-            // Pop the stack
-            scc_vertex = stack.back();
-            stack.pop_back();
-            while( scc_vertex != v )
+            in_offsets[v + 1] = in_offsets[v] + in_degree[v].load( relaxed );
+        }
+        in_neighbours.resize( in_offsets.back() );
+
+        std::vector<std::atomic<size_t>> position( num_nodes );
+        Parallel::for_each_index(
+            num_nodes, [&]( size_t v ) { position[v].store( in_offsets[v], relaxed ); },
+            Parallel::default_min_chunk_size, n_threads );
+        Parallel::for_each_index(
+            num_nodes,
+            [&]( size_t v )
             {
-                scc.push_back( scc_vertex ); // Add to the SCC
-                // Pop the stack
-                scc_vertex = stack.back();
-                stack.pop_back();
-            } // unravelling stack
-            // Add the last vertex
-            scc.push_back( scc_vertex );
-            // Now that we have found the SCC, add it
-            // to the SCC list
-            scc_list.push_back( scc );
-        } // SCC found
+                for( const auto & u : get_neighbours( v ) )
+                {
+                    if( u != v )
+                    {
+                        in_neighbours[position[u].fetch_add( 1, relaxed )] = IndexT( v );
+                    }
+                }
+            },
+            Parallel::default_min_chunk_size, n_threads );
     }
 
-    // Actually run Tarjan's algorithm
-    // for finding strongly connected components (SCCs)
-    void run()
+    // Removes the (already assigned) vertices in frontier and assigns every vertex that becomes trivial
+    template<typename NeighbourFunctionT>
+    void trim( std::vector<IndexT> frontier, NeighbourFunctionT & get_neighbours )
     {
-        // Tarjan's algorithm takes the form of a series of DFS invocations
-        for( size_t i_node = 0; i_node < num_nodes; ++i_node )
+        while( !frontier.empty() )
         {
-            // Start from a node that has not been visited
-            if( !visited[i_node] )
+            frontier = parallel_collect(
+                frontier.size(),
+                [&]( size_t idx, auto & push )
+                {
+                    const size_t v = frontier[idx];
+                    for( const auto & u : get_neighbours( v ) )
+                    {
+                        if( u != v && in_degree[u].fetch_sub( 1, relaxed ) == 1 && claim( u, u ) )
+                        {
+                            push( u );
+                        }
+                    }
+                    for( const auto & u : get_in_neighbours( v ) )
+                    {
+                        if( out_degree[u].fetch_sub( 1, relaxed ) == 1 && claim( u, u ) )
+                        {
+                            push( u );
+                        }
+                    }
+                } );
+        }
+    }
+
+    // The vertex with the most paths through it (by in_degree * out_degree), which likely is in the giant component
+    [[nodiscard]] std::optional<size_t> select_pivot() const
+    {
+        const size_t n_chunk = Parallel::n_chunks( num_nodes, Parallel::default_min_chunk_size, n_threads );
+        std::vector<std::pair<size_t, size_t>> best_per_chunk( n_chunk, { 0, num_nodes } );
+
+        Parallel::for_each_chunk(
+            num_nodes,
+            [&]( size_t idx_begin, size_t idx_end, size_t idx_chunk )
+            {
+                auto & [best_score, best_vertex] = best_per_chunk[idx_chunk];
+                for( size_t v = idx_begin; v < idx_end; v++ )
+                {
+                    const size_t score = in_degree[v].load() * out_degree[v].load();
+                    if( !assigned[v].load() && ( best_vertex == num_nodes || score > best_score ) )
+                    {
+                        best_score  = score;
+                        best_vertex = v;
+                    }
+                }
+            },
+            Parallel::default_min_chunk_size, n_threads );
+
+        std::optional<size_t> pivot = std::nullopt;
+        size_t pivot_score          = 0;
+        for( const auto & [score, v] : best_per_chunk )
+        {
+            if( v != num_nodes && ( !pivot.has_value() || score > pivot_score ) )
+            {
+                pivot       = v;
+                pivot_score = score;
+            }
+        }
+        return pivot;
+    }
+
+    // Assigns the component of pivot, by a backward search within the vertices reachable from pivot
+    template<typename NeighbourFunctionT>
+    std::vector<IndexT> forward_backward( size_t pivot, NeighbourFunctionT & get_neighbours )
+    {
+        // Allocated on first use, like colour and queued
+        if( reachable.empty() )
+        {
+            reachable = std::vector<std::atomic<bool>>( num_nodes );
+        }
+        reachable[pivot].store( true );
+        std::vector<IndexT> frontier = { IndexT( pivot ) };
+        while( !frontier.empty() )
+        {
+            frontier = parallel_collect(
+                frontier.size(),
+                [&]( size_t idx, auto & push )
+                {
+                    for( const auto & u : get_neighbours( frontier[idx] ) )
+                    {
+                        if( assigned[u].load( relaxed ) || reachable[u].load( relaxed ) )
+                        {
+                            continue;
+                        }
+                        if( !reachable[u].exchange( true, relaxed ) )
+                        {
+                            push( u );
+                        }
+                    }
+                } );
+        }
+
+        claim( pivot, pivot );
+        std::vector<IndexT> scc = { IndexT( pivot ) };
+        frontier                = scc;
+        while( !frontier.empty() )
+        {
+            frontier = parallel_collect(
+                frontier.size(),
+                [&]( size_t idx, auto & push )
+                {
+                    for( const auto & u : get_in_neighbours( frontier[idx] ) )
+                    {
+                        if( reachable[u].load( relaxed ) && claim( u, pivot ) )
+                        {
+                            push( u );
+                        }
+                    }
+                } );
+            scc.insert( scc.end(), frontier.begin(), frontier.end() );
+        }
+        return scc;
+    }
+
+    // One round of colouring on the remaining vertices. Gives the vertices that have been assigned
+    template<typename NeighbourFunctionT>
+    std::vector<IndexT> colour_remaining( const std::vector<IndexT> & remaining, NeighbourFunctionT & get_neighbours )
+    {
+        // Allocated in the first round only. Each round resets the entries of the remaining vertices, the others belong
+        // to assigned vertices, which are skipped (and never claimed)
+        if( colour.empty() )
+        {
+            colour = std::vector<std::atomic<IndexT>>( num_nodes );
+            queued = std::vector<std::atomic<bool>>( num_nodes );
+        }
+        Parallel::for_each_index(
+            remaining.size(),
+            [&]( size_t idx )
+            {
+                colour[remaining[idx]].store( remaining[idx] );
+                queued[remaining[idx]].store( true );
+            },
+            Parallel::default_min_chunk_size, n_threads );
+
+        // Propagate the largest colour along the edges, until nothing changes
+        std::vector<IndexT> frontier = remaining;
+        while( !frontier.empty() )
+        {
+            frontier = parallel_collect(
+                frontier.size(),
+                [&]( size_t idx, auto & push )
+                {
+                    const size_t v = frontier[idx];
+                    queued[v].store( false );
+                    const IndexT colour_v = colour[v].load();
+                    for( const auto & u : get_neighbours( v ) )
+                    {
+                        if( u == v || assigned[u].load() )
+                        {
+                            continue;
+                        }
+                        IndexT colour_u = colour[u].load();
+                        while( colour_u < colour_v && !colour[u].compare_exchange_weak( colour_u, colour_v ) )
+                        {
+                        }
+                        if( colour_u < colour_v && !queued[u].exchange( true ) )
+                        {
+                            push( u );
+                        }
+                    }
+                } );
+        }
+
+        // Every root collects the vertices of its colour from which it can be reached
+        const auto roots = parallel_collect(
+            remaining.size(),
+            [&]( size_t idx, auto & push )
+            {
+                if( colour[remaining[idx]].load() == remaining[idx] )
+                {
+                    push( remaining[idx] );
+                }
+            } );
+
+        return parallel_collect(
+            roots.size(),
+            [&]( size_t idx, auto & push )
+            {
+                const IndexT root = roots[idx];
+                claim( root, root );
+                push( root );
+                std::vector<IndexT> stack = { root };
+                while( !stack.empty() )
+                {
+                    const IndexT v = stack.back();
+                    stack.pop_back();
+                    for( const auto & u : get_in_neighbours( v ) )
+                    {
+                        if( colour[u].load() == root && claim( u, root ) )
+                        {
+                            push( u );
+                            stack.push_back( u );
+                        }
+                    }
+                }
+            } );
+    }
+
+    // Assigns the remaining vertices with Tarjan's algorithm, on the subgraph between them
+    template<typename NeighbourFunctionT>
+    void tarjan( const std::vector<IndexT> & remaining, NeighbourFunctionT & get_neighbours )
+    {
+        std::vector<IndexT> local_index( num_nodes );
+        for( size_t idx = 0; idx < remaining.size(); idx++ )
+        {
+            local_index[remaining[idx]] = IndexT( idx );
+        }
+
+        std::vector<size_t> offsets = { 0 };
+        std::vector<IndexT> neighbours{};
+        for( const auto & v : remaining )
+        {
+            for( const auto & u : get_neighbours( v ) )
+            {
+                if( !assigned[u].load() )
+                {
+                    neighbours.push_back( local_index[u] );
+                }
+            }
+            offsets.push_back( neighbours.size() );
+        }
+
+        auto get_local_neighbours = [&]( size_t v )
+        { return std::span<const IndexT>( neighbours.data() + offsets[v], offsets[v + 1] - offsets[v] ); };
+        auto tarjan_scc = TarjanConnectivityAlgo<IndexT>( remaining.size(), get_local_neighbours );
+
+        const auto & local_components = tarjan_scc.components;
+        for( size_t idx_component = 0; idx_component < local_components.size(); idx_component++ )
+        {
+            const size_t root = remaining[local_components[idx_component][0]];
+            for( const auto & v : local_components[idx_component] )
+            {
+                claim( remaining[v], root );
+            }
+        }
+    }
+
+    template<typename NeighbourFunctionT>
+    void run( NeighbourFunctionT & get_neighbours )
+    {
+        build_incoming_edges( get_neighbours );
+
+        // Vertices that are trivial from the start
+        auto trivial = parallel_collect(
+            num_nodes,
+            [&]( size_t v, auto & push )
+            {
+                if( in_degree[v].load() == 0 || out_degree[v].load() == 0 )
+                {
+                    claim( v, v );
+                    push( v );
+                }
+            } );
+        trim( std::move( trivial ), get_neighbours );
+
+        // The giant component
+        const auto pivot = select_pivot();
+        if( pivot.has_value() )
+        {
+            trim( forward_backward( pivot.value(), get_neighbours ), get_neighbours );
+        }
+
+        while( true )
+        {
+            const auto remaining = parallel_collect(
+                num_nodes,
+                [&]( size_t v, auto & push )
+                {
+                    if( !assigned[v].load() )
+                    {
+                        push( v );
+                    }
+                } );
+
+            if( remaining.size() <= serial_threshold )
+            {
+                tarjan( remaining, get_neighbours );
+                break;
+            }
+            trim( colour_remaining( remaining, get_neighbours ), get_neighbours );
+        }
+
+        components = ComponentList<IndexT>::from_representatives( component );
+    }
+};
+
+/*
+    The weakly connected components of a graph, i.e. the connected components if the direction of the edges is
+    ignored. The edges are merged into a lock-free union-find in parallel, where the root of every set is its
+    smallest vertex. The components are sorted (see ComponentList::sort).
+    n_threads is the number of threads used (if not set, see Parallel::get_n_threads)
+*/
+template<typename IndexT = size_t>
+class WeakConnectivityAlgo
+{
+public:
+    /*
+    get_neighbours( v ) has to give a view (e.g. a std::span) into the neighbours of vertex v.
+    It is called from several threads at the same time
+    */
+    template<typename NeighbourFunctionT>
+    WeakConnectivityAlgo(
+        size_t n_vertices, NeighbourFunctionT && get_neighbours, std::optional<size_t> n_threads = std::nullopt )
+            : parent( std::vector<std::atomic<IndexT>>( n_vertices ) )
+    {
+        Parallel::for_each_index(
+            n_vertices, [&]( size_t v ) { parent[v].store( IndexT( v ), relaxed ); }, Parallel::default_min_chunk_size,
+            n_threads );
+
+        Parallel::for_each_index(
+            n_vertices,
+            [&]( size_t v )
+            {
+                for( const auto & u : get_neighbours( v ) )
+                {
+                    unite( v, u );
+                }
+            },
+            Parallel::default_min_chunk_size, n_threads );
+
+        std::vector<IndexT> root( n_vertices );
+        Parallel::for_each_index(
+            n_vertices, [&]( size_t v ) { root[v] = find( v ); }, Parallel::default_min_chunk_size, n_threads );
+        components = ComponentList<IndexT>::from_representatives( root );
+    }
+
+    ComponentList<IndexT> components{}; // The weakly connected components (WCCs)
+
+private:
+    static constexpr auto relaxed = std::memory_order_relaxed;
+
+    std::vector<std::atomic<IndexT>> parent; // parent[v] <= v, the roots are their own parent
+
+    // The root of the set of v. Halves the path on the way, i.e. points every other vertex to its grandparent
+    IndexT find( IndexT v )
+    {
+        while( true )
+        {
+            IndexT v_parent = parent[v].load( relaxed );
+            if( v_parent == v )
+            {
+                return v;
+            }
+            const IndexT v_grandparent = parent[v_parent].load( relaxed );
+            if( v_parent != v_grandparent )
+            {
+                // If this fails, another thread has already shortened the path
+                parent[v].compare_exchange_weak( v_parent, v_grandparent, relaxed );
+            }
+            v = v_grandparent;
+        }
+    }
+
+    // Merges the sets of v1 and v2, by linking the larger root to the smaller one
+    void unite( IndexT v1, IndexT v2 )
+    {
+        while( true )
+        {
+            IndexT root1 = find( v1 );
+            IndexT root2 = find( v2 );
+            if( root1 == root2 )
+            {
+                return;
+            }
+            if( root1 < root2 )
+            {
+                std::swap( root1, root2 );
+            }
+            // Only succeeds if root1 is still a root, otherwise try again with the new roots
+            IndexT expected = root1;
+            if( parent[root1].compare_exchange_strong( expected, root2 ) )
+            {
+                return;
+            }
+        }
+    }
+};
+
+/*
+    The condensation of a graph: the directed acyclic graph (DAG) of its strongly connected components, with an edge
+    from component c1 to c2 if any vertex of c1 has an edge to a vertex of c2.
+    The components are numbered in topological order, so every edge goes from a smaller to a larger component index.
+    Between components without a path between them, the order is deterministic, but arbitrary.
+    The edges of the DAG are stored in CSR format, without duplicates and sorted by target.
+*/
+template<typename IndexT = size_t>
+class CondensationDAG
+{
+public:
+    /*
+    scc are the strongly connected components of the graph given by get_neighbours (in any order, e.g. from
+    TarjanConnectivityAlgo or ParallelConnectivityAlgo). get_neighbours( v ) has to give a view (e.g. a std::span)
+    into the neighbours of vertex v. It is called from several threads at the same time.
+    */
+    template<typename NeighbourFunctionT>
+    CondensationDAG(
+        const ComponentList<IndexT> & scc, NeighbourFunctionT && get_neighbours,
+        std::optional<size_t> n_threads = std::nullopt )
+            : component_of( std::vector<IndexT>( scc.vertices.size() ) )
+    {
+        const size_t n_components = scc.size();
+        Parallel::for_each_index(
+            n_components,
+            [&]( size_t idx_component )
+            {
+                for( const auto & v : scc[idx_component] )
+                {
+                    component_of[v] = IndexT( idx_component );
+                }
+            },
+            Parallel::default_min_chunk_size, n_threads );
+
+        // The edges between the components in the order of scc
+        auto [scc_offsets, scc_neighbours] = component_edges( scc, get_neighbours, n_threads );
+
+        // Kahn's algorithm: a component comes next, once all components with edges to it have been placed
+        std::vector<size_t> n_incoming( n_components, 0 );
+        for( const auto & target : scc_neighbours )
+        {
+            n_incoming[target]++;
+        }
+        std::vector<size_t> topological_order{};
+        topological_order.reserve( n_components );
+        for( size_t idx_component = 0; idx_component < n_components; idx_component++ )
+        {
+            if( n_incoming[idx_component] == 0 )
             {
-                // Call the depth first search
-                depth_first_search( i_node );
+                topological_order.push_back( idx_component );
             }
         }
+        // topological_order doubles as the queue
+        for( size_t idx_queue = 0; idx_queue < topological_order.size(); idx_queue++ )
+        {
+            const size_t idx_component = topological_order[idx_queue];
+            for( size_t idx = scc_offsets[idx_component]; idx < scc_offsets[idx_component + 1]; idx++ )
+            {
+                if( --n_incoming[scc_neighbours[idx]] == 0 )
+                {
+                    topological_order.push_back( scc_neighbours[idx] );
+                }
+            }
+        }
+
+        // Renumber the components in topological order
+        std::vector<IndexT> topological_index( n_components );
+        for( size_t idx = 0; idx < n_components; idx++ )
+        {
+            topological_index[topological_order[idx]] = IndexT( idx );
+        }
+        Parallel::for_each_index(
+            component_of.size(), [&]( size_t v ) { component_of[v] = topological_index[component_of[v]]; },
+            Parallel::default_min_chunk_size, n_threads );
+
+        components.vertices.reserve( scc.vertices.size() );
+        offsets = { 0 };
+        offsets.reserve( n_components + 1 );
+        neighbours.reserve( scc_neighbours.size() );
+        for( const auto & idx_component : topological_order )
+        {
+            auto component = scc[idx_component];
+            components.vertices.insert( components.vertices.end(), component.begin(), component.end() );
+            components.offsets.push_back( components.vertices.size() );
+
+            const size_t row_begin = neighbours.size();
+            for( size_t idx = scc_offsets[idx_component]; idx < scc_offsets[idx_component + 1]; idx++ )
+            {
+                neighbours.push_back( topological_index[scc_neighbours[idx]] );
+            }
+            std::sort( neighbours.begin() + row_begin, neighbours.end() );
+            offsets.push_back( neighbours.size() );
+        }
+    }
+
+    ComponentList<IndexT> components{}; // The strongly connected components, in topological order
+    std::vector<IndexT> component_of{}; // component_of[v] : the index of the component of vertex v
+    std::vector<size_t> offsets{};      // The edges from component c are neighbours[offsets[c]], ...,
+    std::vector<IndexT> neighbours{};   // neighbours[offsets[c+1]-1]
+
+    [[nodiscard]] size_t n_components() const
+    {
+        return components.size();
+    }
+
+    [[nodiscard]] size_t n_edges() const
+    {
+        return neighbours.size();
+    }
+
+    [[nodiscard]] std::span<const IndexT> get_neighbours( size_t idx_component ) const
+    {
+        return std::span<const IndexT>(
+            neighbours.data() + offsets[idx_component], offsets[idx_component + 1] - offsets[idx_component] );
+    }
+
+private:
+    // The edges between different components, without duplicates, as (offsets, neighbours)
+    template<typename NeighbourFunctionT>
+    std::pair<std::vector<size_t>, std::vector<IndexT>> component_edges(
+        const ComponentList<IndexT> & scc, NeighbourFunctionT & get_neighbours, std::optional<size_t> n_threads ) const
+    {
+        const size_t n_components = scc.size();
+        const size_t n_chunk      = Parallel::n_chunks( n_components, Parallel::default_min_chunk_size, n_threads );
+
+        // Every chunk of components collects its edges on its own. The duplicates are removed per component, by
+        // sorting its targets, so the memory needed only grows with the number of edges
+        std::vector<std::vector<IndexT>> neighbours_per_chunk( n_chunk );
+        std::vector<size_t> n_edges_per_component( n_components );
+        Parallel::for_each_chunk(
+            n_components,
+            [&]( size_t idx_begin, size_t idx_end, size_t idx_chunk )
+            {
+                auto & chunk_neighbours = neighbours_per_chunk[idx_chunk];
+                for( size_t idx_component = idx_begin; idx_component < idx_end; idx_component++ )
+                {
+                    const size_t n_before = chunk_neighbours.size();
+                    for( const auto & v : scc[idx_component] )
+                    {
+                        for( const auto & u : get_neighbours( v ) )
+                        {
+                            const size_t target = component_of[u];
+                            if( target != idx_component )
+                            {
+                                chunk_neighbours.push_back( IndexT( target ) );
+                            }
+                        }
+                    }
+                    const auto row_begin = chunk_neighbours.begin() + std::ptrdiff_t( n_before );
+                    std::sort( row_begin, chunk_neighbours.end() );
+                    chunk_neighbours.erase( std::unique( row_begin, chunk_neighbours.end() ), chunk_neighbours.end() );
+                    n_edges_per_component[idx_component] = chunk_neighbours.size() - n_before;
+                }
+            },
+            Parallel::default_min_chunk_size, n_threads );
+
+        std::vector<size_t> scc_offsets( n_components + 1, 0 );
+        std::inclusive_scan( n_edges_per_component.begin(), n_edges_per_component.end(), scc_offsets.begin() + 1 );
+        std::vector<IndexT> scc_neighbours{};
+        scc_neighbours.reserve( scc_offsets.back() );
+        for( const auto & chunk_neighbours : neighbours_per_chunk )
+        {
+            scc_neighbours.insert( scc_neighbours.end(), chunk_neighbours.begin(), chunk_neighbours.end() );
+        }
+        return { std::move( scc_offsets ), std::move( scc_neighbours ) };
+    }
+};
+
+/*
+    Statistics of the (weakly) connected components of a network
+*/
+struct ConnectivityStats
+{
+    size_t n_components         = 0; // including isolated agents, which are components of their own
+    size_t giant_component_size = 0; // the number of agents in the largest component
+    size_t n_isolated           = 0; // agents without any edges
+};
+
+/*
+    Keeps track of the weakly connected components of a network while its edges are added one by one, e.g. for
+    networks that are built from scratch in every iteration. Every edge costs a (nearly constant) union-find step and
+    the statistics are always up to date, so the network never has to be searched as a whole.
+    Edges can not be removed, instead reset starts over with a network without edges.
+*/
+template<typename IndexT = size_t>
+class ConnectivityTracker
+{
+public:
+    ConnectivityTracker() = default;
+
+    ConnectivityTracker( size_t n_vertices )
+    {
+        reset( n_vertices );
+    }
+
+    /*
+    Starts over with n_vertices isolated vertices
+    */
+    void reset( size_t n_vertices )
+    {
+        parent.resize( n_vertices );
+        std::iota( parent.begin(), parent.end(), IndexT( 0 ) );
+        component_size.assign( n_vertices, 1 );
+        current_stats = { n_vertices, std::min<size_t>( n_vertices, 1 ), n_vertices };
+    }
+
+    /*
+    Adds an edge between v1 and v2, in either direction. Self-loops do not connect anything
+    */
+    void add_edge( size_t v1, size_t v2 )
+    {
+        IndexT root1 = find( IndexT( v1 ) );
+        IndexT root2 = find( IndexT( v2 ) );
+        if( root1 == root2 )
+        {
+            return;
+        }
+
+        for( const auto & root : { root1, root2 } )
+        {
+            if( component_size[root] == 1 )
+            {
+                current_stats.n_isolated--;
+            }
+        }
+
+        // Union by size: the smaller tree is attached to the larger one
+        if( component_size[root1] < component_size[root2] )
+        {
+            std::swap( root1, root2 );
+        }
+        parent[root2] = root1;
+        component_size[root1] += component_size[root2];
+
+        current_stats.n_components--;
+        current_stats.giant_component_size
+            = std::max<size_t>( current_stats.giant_component_size, component_size[root1] );
+    }
+
+    [[nodiscard]] const ConnectivityStats & stats() const
+    {
+        return current_stats;
+    }
+
+    [[nodiscard]] MemoryUsage memory_usage() const
+    {
+        MemoryUsage usage{};
+        usage.add( "parent", parent );
+        usage.add( "component_size", component_size );
+        return usage;
+    }
+
+private:
+    std::vector<IndexT> parent{};         // The roots are their own parent
+    std::vector<IndexT> component_size{}; // Only valid for the roots
+    ConnectivityStats current_stats{};
+
+    // The root of the set of v. Halves the path on the way, i.e. points every other vertex to its grandparent
+    IndexT find( IndexT v )
+    {
+        while( parent[v] != v )
+        {
+            parent[v] = parent[parent[v]];
+            v         = parent[v];
+        }
+        return v;
     }
 };
 
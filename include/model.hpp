@@ -1,4 +1,6 @@
 #pragma once
+#include "connectivity.hpp"
+#include "util/memory.hpp"
 #include <cstddef>
 #include <optional>
 
@@ -43,6 +45,23 @@ public:
         }
     };
 
+    /*
+    Gives the memory used by the buffers of the model, not including the network
+    */
+    [[nodiscard]] virtual MemoryUsage memory_usage() const
+    {
+        return {};
+    }
+
+    /*
+    Gives the connectivity of the network created in the last iteration, for models that rebuild the network every
+    iteration. nullopt means that the model does not keep track of it
+    */
+    [[nodiscard]] virtual std::optional<ConnectivityStats> connectivity_stats() const
+    {
+        return std::nullopt;
+    }
+
     virtual ~Model() = default;
 
 private:
@@ -30,10 +30,10 @@ auto check_agent_type( FuncT func )
     }
 }
 
-template<typename AgentT>
-inline auto create_model_degroot( Network<AgentT> & network, const ModelVariantT & model_settings )
+template<typename AgentT, typename WeightT>
+inline auto create_model_degroot( Network<AgentT, WeightT> & network, const ModelVariantT & model_settings )
 {
-    if constexpr( std::is_same_v<AgentT, DeGrootModel::AgentT> )
+    if constexpr( std::is_same_v<Network<AgentT, WeightT>, DeGrootModel::NetworkT> )
     {
         auto degroot_settings = std::get<Config::DeGrootSettings>( model_settings );
         auto model            = std::make_unique<DeGrootModel>( degroot_settings, network );
@@ -41,16 +41,16 @@ inline auto create_model_degroot( Network<AgentT> & network, const ModelVariantT
     }
     else
     {
-        throw std::runtime_error( "Incompatible agent and model type!" );
+        throw std::runtime_error( "Incompatible network and model type!" );
         return std::unique_ptr<Model<AgentT>>{};
     }
 }
 
-template<typename AgentT>
-inline auto
-create_model_activity_driven( Network<AgentT> & network, const ModelVariantT & model_settings, std::mt19937 & gen )
+template<typename AgentT, typename WeightT>
+inline auto create_model_activity_driven(
+    Network<AgentT, WeightT> & network, const ModelVariantT & model_settings, std::mt19937 & gen )
 {
-    if constexpr( std::is_same_v<AgentT, ActivityDrivenModel::AgentT> )
+    if constexpr( std::is_same_v<Network<AgentT, WeightT>, ActivityDrivenModel::NetworkT> )
     {
         auto activitydriven_settings = std::get<Config::ActivityDrivenSettings>( model_settings );
         auto model                   = std::make_unique<ActivityDrivenModel>( activitydriven_settings, network, gen );
@@ -58,16 +58,16 @@ create_model_activity_driven( Network<AgentT> & network, const ModelVariantT & m
     }
     else
     {
-        throw std::runtime_error( "Incompatible agent and model type!" );
+        throw std::runtime_error( "Incompatible network and model type!" );
         return std::unique_ptr<Model<AgentT>>{};
     }
 }
 
-template<typename AgentT>
+template<typename AgentT, typename WeightT>
 inline auto create_model_activity_driven_inertial(
-    Network<AgentT> & network, const ModelVariantT & model_settings, std::mt19937 & gen )
+    Network<AgentT, WeightT> & network, const ModelVariantT & model_settings, std::mt19937 & gen )
 {
-    if constexpr( std::is_same_v<AgentT, InertialModel::AgentT> )
+    if constexpr( std::is_same_v<Network<AgentT, WeightT>, InertialModel::NetworkT> )
     {
         auto settings = std::get<Config::ActivityDrivenInertialSettings>( model_settings );
         auto model    = std::make_unique<InertialModel>( settings, network, gen );
@@ -75,15 +75,16 @@ inline auto create_model_activity_driven_inertial(
     }
     else
     {
-        throw std::runtime_error( "Incompatible agent and model type!" );
+        throw std::runtime_error( "Incompatible network and model type!" );
         return std::unique_ptr<Model<AgentT>>{};
     }
 }
 
-template<typename AgentT>
-inline auto create_model_deffuant( Network<AgentT> & network, const ModelVariantT & model_settings, std::mt19937 & gen )
+template<typename AgentT, typename WeightT>
+inline auto create_model_deffuant(
+    Network<AgentT, WeightT> & network, const ModelVariantT & model_settings, std::mt19937 & gen )
 {
-    if constexpr( std::is_same_v<AgentT, DeffuantModel::AgentT> )
+    if constexpr( std::is_same_v<Network<AgentT, WeightT>, DeffuantModel::NetworkT> )
     {
         auto deffuant_settings = std::get<Config::DeffuantSettings>( model_settings );
         auto model             = std::make_unique<DeffuantModel>( deffuant_settings, network, gen );
@@ -92,16 +93,16 @@ inline auto create_model_deffuant( Network<AgentT> & network, const ModelVariant
     }
     else
     {
-        throw std::runtime_error( "Incompatible agent and model type!" );
+        throw std::runtime_error( "Incompatible network and model type!" );
         return std::unique_ptr<Model<AgentT>>{};
     }
 }
 
-template<typename AgentT>
-inline auto
-create_model_deffuant_vector( Network<AgentT> & network, const ModelVariantT & model_settings, std::mt19937 & gen )
+template<typename AgentT, typename WeightT>
+inline auto create_model_deffuant_vector(
+    Network<AgentT, WeightT> & network, const ModelVariantT & model_settings, std::mt19937 & gen )
 {
-    if constexpr( std::is_same_v<AgentT, DeffuantModelVector::AgentT> )
+    if constexpr( std::is_same_v<Network<AgentT, WeightT>, DeffuantModelVector::NetworkT> )
     {
         auto deffuant_settings = std::get<Config::DeffuantSettings>( model_settings );
         auto model             = std::make_unique<DeffuantModelVector>( deffuant_settings, network, gen );
@@ -110,7 +111,7 @@ create_model_deffuant_vector( Network<AgentT> & network, const ModelVariantT & m
     }
     else
     {
-        throw std::runtime_error( "Incompatible agent and model type!" );
+        throw std::runtime_error( "Incompatible network and model type!" );
         return std::unique_ptr<Model<AgentT>>{};
     }
 }
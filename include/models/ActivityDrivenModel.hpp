@@ -6,9 +6,10 @@
 #include "model.hpp"
 #include "network.hpp"
 #include "network_generation.hpp"
+#include <algorithm>
 #include <cstddef>
+#include <optional>
 #include <random>
-#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -23,12 +24,12 @@ public:
     using AgentT   = AgentT_;
     using NetworkT = Network<AgentT>;
     using WeightT  = typename NetworkT::WeightT;
+    using IndexT   = typename NetworkT::IndexT;
 
     ActivityDrivenModelAbstract(
         const Config::ActivityDrivenSettings & settings, NetworkT & network, std::mt19937 & gen )
             : Model<AgentT>( settings.max_iterations ),
               network( network ),
-              contact_prob_list( std::vector<std::vector<WeightT>>( network.n_agents() ) ),
               gen( gen ),
               dt( settings.dt ),
               m( settings.m ),
@@ -63,14 +64,36 @@ public:
 
     void iteration() override {};
 
+    [[nodiscard]] MemoryUsage memory_usage() const override
+    {
+        MemoryUsage usage{};
+        usage.add( "reciprocated_edges", reciprocated_edges );
+        usage.add( "k1_buffer", k1_buffer );
+        usage.add( "k2_buffer", k2_buffer );
+        usage.add( "k3_buffer", k3_buffer );
+        usage.add( "k4_buffer", k4_buffer );
+        usage.add( "connectivity_tracker", connectivity_tracker.memory_usage() );
+        return usage;
+    }
+
+    [[nodiscard]] std::optional<ConnectivityStats> connectivity_stats() const override
+    {
+        // With mean weights, the network is complete and does not change
+        if( mean_weights )
+        {
+            return std::nullopt;
+        }
+        return connectivity_tracker.stats();
+    }
+
 protected:
     NetworkT & network;
 
 private:
-    std::vector<std::vector<WeightT>> contact_prob_list; // Probability of choosing i in 1 to m rounds
     // Random number generation
     std::mt19937 & gen; // reference to simulation Mersenne-Twister engine
-    std::set<std::pair<size_t, size_t>> reciprocal_edge_buffer{};
+    std::vector<std::pair<IndexT, IndexT>> reciprocated_edges{}; // Edges added by reciprocation, in order
+    ConnectivityTracker<IndexT> connectivity_tracker{};          // Components of the network of the last iteration
 
 protected:
     // Model-specific parameters
@@ -172,8 +195,8 @@ private:
 
         std::uniform_real_distribution<> dis_activation( 0.0, 1.0 );
         std::uniform_real_distribution<> dis_reciprocation( 0.0, 1.0 );
-        std::vector<size_t> contacted_agents{};
-        reciprocal_edge_buffer.clear(); // Clear the reciprocal edge buffer
+        std::vector<IndexT> contacted_agents{};
+        connectivity_tracker.reset( network.n_agents() );
         for( size_t idx_agent = 0; idx_agent < network.n_agents(); idx_agent++ )
         {
             // Test if the agent is activated
@@ -195,15 +218,12 @@ private:
                     m_temp, network.n_agents(), [&]( int j ) { return homophily_weight( idx_agent, j ); },
                     contacted_agents, gen );
 
-                // Fill the outgoing edges into the reciprocal edge buffer
-                for( const auto & idx_outgoing : contacted_agents )
+                // Set the *outgoing* edges, in the order of the reservoir sampling, which the reciprocity draws follow
+                network.set_neighbours_and_weights( idx_agent, contacted_agents, 1.0 );
+                for( const auto & idx_contacted : contacted_agents )
                 {
-                    reciprocal_edge_buffer.insert(
-                        { idx_agent, idx_outgoing } ); // insert the edge idx_agent -> idx_outgoing
+                    connectivity_tracker.add_edge( idx_agent, idx_contacted );
                 }
-
-                // Set the *outgoing* edges
-                network.set_neighbours_and_weights( idx_agent, contacted_agents, 1.0 );
             }
             else
             {
@@ -212,6 +232,8 @@ private:
         }
 
         // Reciprocity check
+        // The reciprocated edges are only added afterwards, so that has_edge only scans the contacts of this round
+        reciprocated_edges.clear();
         for( size_t idx_agent = 0; idx_agent < network.n_agents(); idx_agent++ )
         {
             // Get the outgoing edges
@@ -220,16 +242,22 @@ private:
             for( const auto & idx_outgoing : contacted_agents )
             {
                 // If the edge is not reciprocated
-                if( !reciprocal_edge_buffer.contains( { idx_outgoing, idx_agent } ) )
+                if( !network.has_edge( idx_outgoing, idx_agent ) )
                 {
                     if( dis_reciprocation( gen ) < reciprocity )
                     {
-                        network.push_back_neighbour_and_weight( idx_outgoing, idx_agent, 1.0 );
+                        reciprocated_edges.emplace_back( idx_outgoing, IndexT( idx_agent ) );
                     }
                 }
             }
         }
 
+        // The reciprocated edges connect agents that are already connected, so the connectivity does not change
+        for( const auto & [idx_from, idx_to] : reciprocated_edges )
+        {
+            network.push_back_neighbour_and_weight( idx_from, idx_to, 1.0 );
+        }
+
         network.toggle_incoming_outgoing(); // switch direction, so that we have incoming edges
     }
 
@@ -241,7 +269,6 @@ private:
         for( size_t idx_agent = 0; idx_agent < network.n_agents(); idx_agent++ )
         {
             network.set_weights( idx_agent, weights );
-            contact_prob_list[idx_agent] = weights; // set to zero
         }
 
         auto probability_helper = []( double omega, size_t m )
@@ -252,20 +279,21 @@ private:
             return p;
         };
 
+        // Implement the weight for the probability of agent `idx_agent` contacting agent `j`
+        // Not normalised since this is taken care of by the reservoir sampling
+        std::vector<double> normalization( network.n_agents(), 0.0 );
         for( size_t idx_agent = 0; idx_agent < network.n_agents(); idx_agent++ )
         {
-            // Implement the weight for the probability of agent `idx_agent` contacting agent `j`
-            // Not normalised since this is taken care of by the reservoir sampling
-
-            double normalization = 0;
             for( size_t k = 0; k < network.n_agents(); k++ )
             {
-                normalization += homophily_weight( idx_agent, k );
+                normalization[idx_agent] += homophily_weight( idx_agent, k );
             }
+        }
 
-            // Go through all the neighbours of idx_agent
-            // Calculate the probability of i contacting j (in 1 to m rounds, assuming
-            // the agent is activated
+        // Calculate the probability of i contacting j (in 1 to m rounds, assuming the agent is activated)
+        // This is done on the fly, so that we never store the probabilities of all n_agents^2 pairs
+        auto contact_probability = [&]( size_t idx_agent, size_t j )
+        {
             int m_temp = m;
             if( bot_present() && idx_agent < n_bots )
             {
@@ -273,22 +301,19 @@ private:
             }
 
             double activity = std::max( 1.0, network.agents[idx_agent].data.activity );
-            for( size_t j = 0; j < network.n_agents(); j++ )
-            {
-                double omega = homophily_weight( idx_agent, j ) / normalization;
-                // We can calculate the probability of i contacting j ( i->j )
-                // Update contact prob_list (outgoing)
-                contact_prob_list[idx_agent][j] = activity * probability_helper( omega, m_temp );
-            }
-        }
+            double omega    = homophily_weight( idx_agent, j ) / normalization[idx_agent];
+            return WeightT( activity * probability_helper( omega, m_temp ) );
+        };
 
+        // The network is stored as StorageType::FullyConnected, so the weight of the edge coming from agent j is
+        // found at position j of every row, without a lookup
         for( size_t idx_agent = 0; idx_agent < network.n_agents(); idx_agent++ )
         {
             // Calculate the actual weights and reciprocity
             for( size_t j = 0; j < network.n_agents(); j++ )
             {
-                double prob_contact_ij = contact_prob_list[idx_agent][j]; // outgoing probabilites
-                double prob_contact_ji = contact_prob_list[j][idx_agent];
+                double prob_contact_ij = contact_probability( idx_agent, j ); // outgoing probabilites
+                double prob_contact_ji = contact_probability( j, idx_agent );
 
                 // Set the incoming agent weight, j-i in weight list
                 double & win_ji = network.get_weights( j )[idx_agent];
@@ -333,15 +358,25 @@ protected:
 
         for( size_t idx_agent = 0; idx_agent < network.n_agents(); ++idx_agent )
         {
-            auto neighbour_buffer = network.get_neighbours( idx_agent ); // Get the incoming neighbours
-            auto weight_buffer    = network.get_weights( idx_agent );    // Get incoming weights
+            // Read through a const network, since the mean weights use StorageType::FullyConnected
+            auto neighbour_buffer = std::as_const( network ).get_neighbours( idx_agent ); // Get the incoming neighbours
+            auto weight_buffer    = std::as_const( network ).get_weights( idx_agent );    // Get incoming weights
             k_buffer[idx_agent]   = -opinion( idx_agent );
             // Loop through neighbouring agents
             for( size_t j = 0; j < neighbour_buffer.size(); j++ )
             {
                 j_index = neighbour_buffer[j];
-                k_buffer[idx_agent] += 1.0 / network.agents[idx_agent].data.reluctance * K * weight_buffer[j]
-                                       * std::tanh( alpha * opinion( j_index ) );
+                // Without stored weights, every weight is 1 and we skip the multiplication
+                if constexpr( NetworkT::is_weighted )
+                {
+                    k_buffer[idx_agent] += 1.0 / network.agents[idx_agent].data.reluctance * K * weight_buffer[j]
+                                           * std::tanh( alpha * opinion( j_index ) );
+                }
+                else
+                {
+                    k_buffer[idx_agent] += 1.0 / network.agents[idx_agent].data.reluctance * K
+                                           * std::tanh( alpha * opinion( j_index ) );
+                }
             }
             // Here, we won't multiply by the timestep.
             // Instead multiply in the update rule
@@ -20,6 +20,13 @@ public:
     void iteration() override;
     bool finished() override;
 
+    [[nodiscard]] MemoryUsage memory_usage() const override
+    {
+        MemoryUsage usage{};
+        usage.add( "agents_current_copy", agents_current_copy );
+        return usage;
+    }
+
 private:
     double convergence_tol{};
     std::optional<double> max_opinion_diff = std::nullopt;
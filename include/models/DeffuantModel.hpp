@@ -6,7 +6,11 @@
 #include "model.hpp"
 #include "network.hpp"
 #include "util/math.hpp"
+#include <cmath>
 #include <cstddef>
+#include <functional>
+#include <numeric>
+#include <optional>
 #include <random>
 
 #include "network_generation.hpp"
@@ -21,7 +25,7 @@ class DeffuantModelAbstract : public Model<AgentT_>
 {
 public:
     using AgentT   = AgentT_;
-    using NetworkT = Network<AgentT>;
+    using NetworkT = Network<AgentT, Unweighted>; // The model does not use the edge weights
 
     DeffuantModelAbstract( const Config::DeffuantSettings & settings, NetworkT & network, std::mt19937 & gen )
             : Model<AgentT>( settings.max_iterations ),
@@ -31,15 +35,29 @@ public:
               network( network ),
               gen( gen )
     {
-        // Generate the network as a square lattice if use_network is true
+        // Generate the network as a periodic lattice (by default a square lattice) if use_network is true
         if( use_network )
         {
-            size_t n_edge = std::sqrt( network.n_agents() );
-            if( n_edge * n_edge != network.n_agents() )
+            using Neighbourhood = NetworkGeneration::LatticeStencil::Neighbourhood;
+            const size_t n_dims = settings.lattice_dim;
+            const auto n_edge   = size_t( std::llround( std::pow( double( network.n_agents() ), 1.0 / n_dims ) ) );
+            auto extents        = std::vector<size_t>( n_dims, n_edge );
+            auto n_sites        = std::accumulate( extents.begin(), extents.end(), size_t( 1 ), std::multiplies{} );
+            if( n_sites != network.n_agents() )
             {
-                throw std::runtime_error( "Number of agents is not a square number." );
+                throw std::runtime_error( fmt::format( "Number of agents is not a power {} of an integer.", n_dims ) );
+            }
+
+            const auto neighbourhood = settings.moore_neighbourhood ? Neighbourhood::Moore : Neighbourhood::VonNeumann;
+            lattice = NetworkGeneration::LatticeStencil( std::move( extents ), neighbourhood, settings.lattice_radius );
+            network = NetworkGeneration::generate_lattice<AgentT, Unweighted>( lattice.value() );
+
+            // Turn the lattice into a small-world network
+            if( settings.rewiring_probability > 0 )
+            {
+                NetworkGeneration::rewire_edges( network, settings.rewiring_probability, RNGStreams( gen() ) );
+                rewired = true;
             }
-            network = NetworkGeneration::generate_square_lattice<AgentT>( n_edge );
         }
     }
 
@@ -62,12 +80,13 @@ public:
             auto agent1_idx = dist( gen );
             interacting_agents.push_back( agent1_idx );
 
-            // Choose a neighbour randomly from the neighbour list of agent1_idx
-            auto neighbours     = network.get_neighbours( agent1_idx );
-            auto n_neighbours   = neighbours.size();
-            auto dist_n         = std::uniform_int_distribution<size_t>( 0, n_neighbours - 1 );
+            // Choose a neighbour randomly out of the lattice neighbours of agent1_idx.
+            // They are computed directly from the stencil, in the same order as in the network, instead of looking
+            // them up. Rewiring keeps the number of neighbours of every agent, but then they have to be looked up
+            auto dist_n         = std::uniform_int_distribution<size_t>( 0, lattice->n_neighbours() - 1 );
             auto index_in_neigh = dist_n( gen ); // Index inside neighbours list
-            auto agent2_idx     = neighbours[index_in_neigh];
+            auto agent2_idx     = rewired ? size_t( network.get_neighbours( agent1_idx )[index_in_neigh] )
+                                          : lattice->neighbour( agent1_idx, index_in_neigh );
             interacting_agents.push_back( agent2_idx );
 
             return interacting_agents;
@@ -104,6 +123,8 @@ private:
     double homophily_threshold{}; // d in paper
     double mu{};                  // convergence parameter
     bool use_network{};           // for the basic Deffuant model
+    std::optional<NetworkGeneration::LatticeStencil> lattice{}; // The neighbourhood of the lattice, if use_network
+    bool rewired = false; // Whether the edges of the lattice have been rewired
     NetworkT & network;
     std::mt19937 & gen; // reference to simulation Mersenne-Twister engine
 };
@@ -28,6 +28,14 @@ public:
 
     void iteration() override;
 
+    [[nodiscard]] MemoryUsage memory_usage() const override
+    {
+        auto usage = ActivityDrivenModelAbstract<InertialAgent>::memory_usage();
+        usage.add( "drift_t_buffer", drift_t_buffer );
+        usage.add( "drift_next_t_buffer", drift_next_t_buffer );
+        return usage;
+    }
+
 private:
     double friction_coefficient = 1.0;
     std::vector<double> drift_t_buffer{};
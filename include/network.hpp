@@ -1,17 +1,61 @@
 #pragma once
 #include "connectivity.hpp"
+#include "util/memory.hpp"
+#include "util/parallel.hpp"
 #include <fmt/format.h>
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <numeric>
 #include <optional>
+#include <ranges>
 #include <span>
 #include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace Seldon
 {
 
+/*
+    The integer type of the neighbour indices, which all models use by default. Building with
+    -DSELDON_32BIT_INDICES (meson option narrow_indices) halves the memory traffic for the edges, but limits
+    the number of agents to 2^32.
+*/
+#ifdef SELDON_32BIT_INDICES
+using DefaultIndexT = std::uint32_t;
+#else
+using DefaultIndexT = std::size_t;
+#endif
+
+/*
+    Tag for the WeightType of a network without edge weights. Such a network stores no weights at all,
+    every edge has the weight 1.
+*/
+struct Unweighted
+{
+};
+
+/*
+    A read-only view of n copies of the same value, used as the weights of an unweighted network
+*/
+template<typename ValueT>
+struct ConstantValue
+{
+    ValueT value{};
+    ValueT operator()( size_t ) const
+    {
+        return value;
+    }
+};
+
+template<typename ValueT>
+using ConstantView = std::ranges::transform_view<std::ranges::iota_view<size_t, size_t>, ConstantValue<ValueT>>;
+
 /*
     A class that represents a directed graph using adjacency lists.
     Either incoming or outgoing edges are stored.
@@ -26,10 +70,43 @@ namespace Seldon
     N^T (out) |   switch  | transpose |   toggle   |     X     |
 
     Note: switch is equivalent to toggle + transpose, but much cheaper!
+
+    The edges can either be stored as one vector per agent (StorageType::AdjacencyList), which is cheap to modify,
+    or in compressed sparse row format (StorageType::CSR), where the neighbours and weights of all agents live in two
+    contiguous arrays indexed by an offsets array. The CSR format is cheaper to iterate over and to serialize.
+    Operations that change the number of edges of an agent convert a CSR network back to adjacency lists.
+    A complete graph can be stored implicitly (StorageType::FullyConnected): all agents share one row of neighbour
+    indices 0, 1, ..., n_agents-1 (so the writable get_neighbours throws), and only the weights are stored, row by row.
+    Operations that change the neighbours convert it to adjacency lists. The n_agents^2 weights are still stored
+    densely (unless the network is Unweighted), since every edge can have its own weight and get_weights hands out
+    writable spans.
+    Lattices have no implicit storage, they are stored like any other network. Kernels that only need the neighbours
+    of a lattice site can compute them with a NetworkGeneration::LatticeStencil instead (see the Deffuant model).
+
+    Optionally (set_dual_direction), the network keeps the incoming *and* the outgoing edges. Then toggle and
+    transpose only swap the two representations, and both directions can be read with get_neighbours(idx, direction).
+    The mutating functions keep both directions in sync. For many mutations at once, use bulk_update, which
+    rebuilds the other direction only once at the end.
+
+    With WeightType = Unweighted, no weights are stored and get_weights gives a view of constant weights 1.
+
+    The neighbour indices are stored as IndexType, which has to be an unsigned integer type that can hold the index of
+    every agent.
+
+    The network keeps track of whether the neighbours of every agent are sorted by index (rows_sorted). This is checked
+    on construction and kept up to date by the mutating functions; toggle_incoming_outgoing, remove_double_counting and
+    sort_rows leave all rows sorted. Then has_edge and edge_weight use a binary search, otherwise a linear scan.
+    Writing neighbour indices through get_neighbours is not tracked, call sort_rows afterwards if that could unsort a
+    row.
+
+    The agents can be relabeled (permute_agents), e.g. to improve the memory locality of the edges. The network
+    remembers the index every agent had originally (original_index), so that the output can use the original indices.
 */
-template<typename AgentType, typename WeightType = double>
+template<typename AgentType, typename WeightType = double, typename IndexType = DefaultIndexT>
 class Network
 {
+    static_assert( std::is_unsigned_v<IndexType>, "Network: IndexType has to be an unsigned integer type" );
+
 public:
     enum class EdgeDirection
     {
@@ -37,35 +114,105 @@ public:
         Outgoing
     };
 
-    using WeightT = WeightType;
+    enum class StorageType
+    {
+        AdjacencyList,
+        CSR,
+        FullyConnected
+    };
+
+    // Whether the weights are stored. If not, WeightT is the type of the constant weights
+    static constexpr bool is_weighted = !std::is_same_v<WeightType, Unweighted>;
+
+    using WeightT = std::conditional_t<is_weighted, WeightType, double>;
     using AgentT  = AgentType;
+    using IndexT  = IndexType;
+
+    // The views returned by get_weights
+    using WeightView      = std::conditional_t<is_weighted, std::span<WeightT>, ConstantView<WeightT>>;
+    using ConstWeightView = std::conditional_t<is_weighted, std::span<const WeightT>, ConstantView<WeightT>>;
     // @TODO: Make this private later
     std::vector<AgentT> agents{}; // List of agents of type AgentType
 
     Network() = default;
 
-    Network( size_t n_agents )
-            : agents( std::vector<AgentT>( n_agents ) ),
-              neighbour_list( std::vector<std::vector<size_t>>( n_agents, std::vector<size_t>{} ) ),
-              weight_list( std::vector<std::vector<WeightT>>( n_agents, std::vector<WeightT>{} ) )
+    Network( size_t n_agents ) : agents( std::vector<AgentT>( n_agents ) ), edges( n_agents )
     {
+        check_index_range();
     }
 
-    Network( std::vector<AgentT> agents )
-            : agents( agents ),
-              neighbour_list( std::vector<std::vector<size_t>>( agents.size(), std::vector<size_t>{} ) ),
-              weight_list( std::vector<std::vector<WeightT>>( agents.size(), std::vector<WeightT>{} ) )
+    Network( std::vector<AgentT> agents ) : agents( std::move( agents ) ), edges( this->agents.size() )
+    {
+        check_index_range();
+    }
+
+    Network(
+        std::vector<std::vector<IndexT>> && neighbour_list, std::vector<std::vector<WeightT>> && weight_list,
+        EdgeDirection direction )
+            : agents( std::vector<AgentT>( neighbour_list.size() ) ), _direction( direction )
     {
+        edges.neighbour_list = std::move( neighbour_list );
+        if constexpr( is_weighted )
+        {
+            edges.weight_list = std::move( weight_list );
+        }
+        edges.update_rows_sorted();
+        check_index_range();
     }
 
+    /*
+    Constructs a network in CSR format. The neighbours and weights of agent i are found in the index range
+    [offsets[i], offsets[i+1]) of the neighbours and weights arrays.
+    */
     Network(
-        std::vector<std::vector<size_t>> && neighbour_list, std::vector<std::vector<WeightT>> && weight_list,
+        std::vector<size_t> && offsets, std::vector<IndexT> && neighbours, std::vector<WeightT> && weights,
         EdgeDirection direction )
-            : agents( std::vector<AgentT>( neighbour_list.size() ) ),
-              neighbour_list( neighbour_list ),
-              weight_list( weight_list ),
-              _direction( direction )
+            : agents( std::vector<AgentT>( offsets.empty() ? 0 : offsets.size() - 1 ) ), _direction( direction )
+    {
+        edges.type           = StorageType::CSR;
+        edges.csr_offsets    = std::move( offsets );
+        edges.csr_neighbours = std::move( neighbours );
+
+        if( edges.csr_offsets.empty() )
+        {
+            edges.csr_offsets.push_back( 0 );
+        }
+
+        // Unweighted networks ignore the weights
+        if constexpr( is_weighted )
+        {
+            edges.csr_weights = std::move( weights );
+        }
+
+        if( ( is_weighted && edges.csr_neighbours.size() != edges.csr_weights.size() )
+            || edges.csr_offsets.back() != edges.csr_neighbours.size() )
+        {
+            throw std::runtime_error( "Network: the CSR offsets, neighbours and weights are inconsistent!" );
+        }
+        edges.update_rows_sorted();
+        check_index_range();
+    }
+
+    /*
+    Constructs a fully connected network (StorageType::FullyConnected), which does not store the neighbour indices.
+    The weights of agent i are found in the index range [i*n_agents, (i+1)*n_agents) of the weights array.
+    */
+    Network( size_t n_agents, std::vector<WeightT> && weights, EdgeDirection direction )
+            : agents( std::vector<AgentT>( n_agents ) ), _direction( direction )
     {
+        check_index_range();
+        edges.type = StorageType::FullyConnected;
+        edges.csr_neighbours.resize( n_agents );
+        std::iota( edges.csr_neighbours.begin(), edges.csr_neighbours.end(), IndexT( 0 ) );
+
+        if constexpr( is_weighted )
+        {
+            if( weights.size() != n_agents * n_agents )
+            {
+                throw std::runtime_error( "Network: a fully connected network needs n_agents^2 weights!" );
+            }
+            edges.csr_weights = std::move( weights );
+        }
     }
 
     /*
@@ -84,14 +231,9 @@ public:
     {
         if( agent_idx.has_value() )
         {
-            return neighbour_list[agent_idx.value()].size();
-        }
-        else
-        {
-            return std::transform_reduce(
-                neighbour_list.cbegin(), neighbour_list.cend(), 0, std::plus{},
-                []( const auto & neigh_list ) { return neigh_list.size(); } );
+            return get_neighbours( agent_idx.value() ).size();
         }
+        return edges.n_edges();
     }
 
     /*
@@ -103,40 +245,340 @@ public:
     }
 
     /*
-    Gives the strongly connected components in the graph
+    Returns the format in which the edges are currently stored.
+    */
+    [[nodiscard]] const StorageType & storage() const
+    {
+        return edges.type;
+    }
+
+    /*
+    Converts the edges to the given storage format (expensive, if the format changes).
+    Example: AdjacencyList -> CSR
+    */
+    void set_storage( StorageType storage )
+    {
+        edges.convert( storage );
+        if( dual_direction() )
+        {
+            reverse_edges.convert( storage );
+        }
+    }
+
+    /*
+    Returns true, if both the incoming and the outgoing edges are kept
+    */
+    [[nodiscard]] bool dual_direction() const
+    {
+        return _dual_direction;
+    }
+
+    /*
+    Starts (expensive) or stops keeping the edges of the other direction as well.
+    This doubles the memory used for the edges, but makes toggle_incoming_outgoing and transpose O(1)
+    */
+    void set_dual_direction( bool dual_direction )
+    {
+        if( dual_direction && !_dual_direction )
+        {
+            transpose_edges( edges, reverse_edges, transpose_buffers.counters );
+        }
+        else if( !dual_direction )
+        {
+            reverse_edges = EdgeStorage{};
+        }
+        _dual_direction = dual_direction;
+    }
+
+    /*
+    Calls func(), in which the network can be modified freely, and brings the other direction back in sync
+    afterwards with a single transpose. Within func(), the mutating functions only touch the stored direction and
+    get_neighbours/get_weights can only be called for direction().
+    Also use this when writing through the spans returned by get_neighbours/get_weights in dual direction mode.
+    */
+    template<typename FuncT>
+    void bulk_update( FuncT && func )
+    {
+        if( !dual_direction() )
+        {
+            func();
+            return;
+        }
+
+        _dual_direction = false;
+        try
+        {
+            func();
+        }
+        catch( ... )
+        {
+            set_dual_direction( true );
+            throw;
+        }
+        set_dual_direction( true );
+    }
+
+    /*
+    Relabels the agents, such that agent new_order[i] becomes agent i. The agents move together with their edges
+    (in both directions, in dual direction mode). The storage type and the order of the edges within a row are kept.
+    new_order has to be a permutation of 0, 1, ..., n_agents-1
+    */
+    void permute_agents( std::span<const size_t> new_order )
+    {
+        const size_t n = n_agents();
+        if( new_order.size() != n )
+        {
+            throw std::runtime_error( "Network::permute_agents: new_order needs one entry per agent!" );
+        }
+
+        // new_index[j] is the index that agent j gets
+        std::vector<IndexT> new_index( n );
+        std::vector<bool> seen( n, false );
+        for( size_t i = 0; i < n; i++ )
+        {
+            if( new_order[i] >= n || seen[new_order[i]] )
+            {
+                throw std::runtime_error( "Network::permute_agents: new_order is not a permutation of the agents!" );
+            }
+            seen[new_order[i]]       = true;
+            new_index[new_order[i]] = IndexT( i );
+        }
+
+        edges = edges.permuted( new_order, new_index );
+        if( dual_direction() )
+        {
+            reverse_edges = reverse_edges.permuted( new_order, new_index );
+        }
+
+        std::vector<AgentT> permuted_agents{};
+        permuted_agents.reserve( n );
+        std::vector<IndexT> permuted_original_indices( n );
+        for( size_t i = 0; i < n; i++ )
+        {
+            permuted_agents.push_back( std::move( agents[new_order[i]] ) );
+            permuted_original_indices[i] = IndexT( original_index( new_order[i] ) );
+        }
+        agents           = std::move( permuted_agents );
+        original_indices = std::move( permuted_original_indices );
+
+        current_indices.resize( n );
+        for( size_t i = 0; i < n; i++ )
+        {
+            current_indices[original_indices[i]] = IndexT( i );
+        }
+    }
+
+    /*
+    Gives the index that agent_idx had before the agents were relabeled with permute_agents
+    */
+    [[nodiscard]] size_t original_index( size_t agent_idx ) const
+    {
+        return original_indices.empty() ? agent_idx : original_indices[agent_idx];
+    }
+
+    /*
+    Gives the current index of the agent that originally had the index idx_original (inverse of original_index)
+    */
+    [[nodiscard]] size_t agent_index( size_t idx_original ) const
+    {
+        return current_indices.empty() ? idx_original : current_indices[idx_original];
+    }
+
+    /*
+    Returns true, if the neighbours of every agent are sorted by index
+    */
+    [[nodiscard]] bool rows_sorted() const
+    {
+        return edges.rows_sorted;
+    }
+
+    /*
+    Sorts the neighbours of every agent by index, keeping the order of double edges
+    */
+    void sort_rows()
+    {
+        // The rows might have been written through get_neighbours, which is not tracked
+        edges.update_rows_sorted();
+        edges.sort_rows();
+        if( dual_direction() )
+        {
+            reverse_edges.sort_rows();
+        }
+    }
+
+    /*
+    Returns true, if there is an edge going from agent idx_from to agent idx_to.
+    O(log(n_neighbours)) if rows_sorted(), O(n_neighbours) otherwise
+    */
+    [[nodiscard]] bool has_edge( size_t idx_from, size_t idx_to ) const
+    {
+        return find_edge( idx_from, idx_to ).has_value();
+    }
+
+    /*
+    Gives the weight of the edge going from agent idx_from to agent idx_to, or nullopt if there is no such edge.
+    For double edges, the weight of the first one is returned.
+    O(log(n_neighbours)) if rows_sorted(), O(n_neighbours) otherwise
+    */
+    [[nodiscard]] std::optional<WeightT> edge_weight( size_t idx_from, size_t idx_to ) const
+    {
+        auto position = find_edge( idx_from, idx_to );
+        if( !position.has_value() )
+        {
+            return std::nullopt;
+        }
+        const auto [idx_row, idx_in_row] = position.value();
+        return edges.weights( idx_row )[idx_in_row];
+    }
+
+    /*
+    Gives the memory used by the agents and the edges (and the buffers kept between calls), per data structure
+    */
+    [[nodiscard]] MemoryUsage memory_usage() const
+    {
+        MemoryUsage usage{};
+        usage.add( "agents", agents );
+        usage.add( "edges", edges.memory_usage() );
+        usage.add( "reverse_edges", reverse_edges.memory_usage() );
+        usage.add( "transpose_buffers", transpose_buffers.edges.memory_usage() );
+        usage.add( "transpose_buffers.counters", transpose_buffers.counters );
+        usage.add( "original_indices", original_indices );
+        usage.add( "current_indices", current_indices );
+        return usage;
+    }
+
+    /*
+    Gives the strongly connected components in the graph, in the direction of the stored edges.
+    The neighbours are read in place, so this does not copy the network
     */
-    [[nodiscard]] std::vector<std::vector<size_t>> strongly_connected_components() const
+    [[nodiscard]] ComponentList<IndexT> strongly_connected_components() const
     {
-        // Now that we have the neighbour list (or adjacency list)
+        // A complete graph is a single component. This is the order in which Tarjan's algorithm would find it
+        if( storage() == StorageType::FullyConnected )
+        {
+            ComponentList<IndexT> components{};
+            if( n_agents() > 0 )
+            {
+                components.vertices.resize( n_agents() );
+                std::iota( components.vertices.rbegin(), components.vertices.rend(), IndexT( 0 ) );
+                components.offsets.push_back( n_agents() );
+            }
+            return components;
+        }
+
         // Run Tarjan's algorithm for strongly connected components
-        auto tarjan_scc = TarjanConnectivityAlgo( neighbour_list );
-        return tarjan_scc.scc_list;
+        auto tarjan_scc = TarjanConnectivityAlgo<IndexT>(
+            n_agents(), [this]( size_t agent_idx ) { return get_neighbours( agent_idx ); } );
+        return std::move( tarjan_scc.components );
+    }
+
+    /*
+    Gives the same strongly connected components as strongly_connected_components, but computed with a parallel
+    algorithm (see ParallelConnectivityAlgo). The components are sorted by their smallest agent, and the agents within
+    every component are sorted. n_threads is the number of threads (if not set, see Parallel::get_n_threads)
+    */
+    [[nodiscard]] ComponentList<IndexT>
+    parallel_strongly_connected_components( std::optional<size_t> n_threads = std::nullopt ) const
+    {
+        if( storage() == StorageType::FullyConnected )
+        {
+            auto components = strongly_connected_components();
+            components.sort();
+            return components;
+        }
+
+        auto parallel_scc = ParallelConnectivityAlgo<IndexT>(
+            n_agents(), [this]( size_t agent_idx ) { return get_neighbours( agent_idx ); }, n_threads );
+        return std::move( parallel_scc.components );
+    }
+
+    /*
+    Gives the weakly connected components in the graph, i.e. ignoring the direction of the edges, sorted like
+    parallel_strongly_connected_components. n_threads is the number of threads (if not set, see
+    Parallel::get_n_threads)
+    */
+    [[nodiscard]] ComponentList<IndexT>
+    weakly_connected_components( std::optional<size_t> n_threads = std::nullopt ) const
+    {
+        if( storage() == StorageType::FullyConnected )
+        {
+            return parallel_strongly_connected_components( n_threads );
+        }
+
+        auto wcc = WeakConnectivityAlgo<IndexT>(
+            n_agents(), [this]( size_t agent_idx ) { return get_neighbours( agent_idx ); }, n_threads );
+        return std::move( wcc.components );
+    }
+
+    /*
+    Gives the condensation of the graph, i.e. the DAG of its strongly connected components in topological order, in
+    the direction of the stored edges. n_threads is the number of threads (if not set, see Parallel::get_n_threads)
+    */
+    [[nodiscard]] CondensationDAG<IndexT> condensation( std::optional<size_t> n_threads = std::nullopt ) const
+    {
+        const auto scc = parallel_strongly_connected_components( n_threads );
+
+        // All edges of a complete graph are within its single component, so they do not have to be looked at
+        if( storage() == StorageType::FullyConnected )
+        {
+            return CondensationDAG<IndexT>( scc, []( size_t ) { return std::span<const IndexT>{}; }, n_threads );
+        }
+        return CondensationDAG<IndexT>(
+            scc, [this]( size_t agent_idx ) { return get_neighbours( agent_idx ); }, n_threads );
     }
 
     /*
     Gives a view into the neighbour indices going out/coming in at agent_idx
     */
-    [[nodiscard]] std::span<const size_t> get_neighbours( std::size_t agent_idx ) const
+    [[nodiscard]] std::span<const IndexT> get_neighbours( std::size_t agent_idx ) const
+    {
+        return edges.neighbours( agent_idx );
+    }
+
+    /*
+    Gives a writable view into the neighbour indices going out/coming in at agent_idx.
+    All agents of a fully connected network share one row of neighbours, so this throws for
+    StorageType::FullyConnected. Read those through a const network, or convert it to adjacency lists first
+    */
+    [[nodiscard]] std::span<IndexT> get_neighbours( std::size_t agent_idx )
     {
-        return std::span( neighbour_list[agent_idx].data(), neighbour_list[agent_idx].size() );
+        if( storage() == StorageType::FullyConnected )
+        {
+            throw std::runtime_error(
+                "Network::get_neighbours: the neighbours of a fully connected network can not be written to!" );
+        }
+        return edges.neighbours( agent_idx );
     }
 
-    [[nodiscard]] std::span<size_t> get_neighbours( std::size_t agent_idx )
+    /*
+    Gives a view into the neighbour indices in the given direction.
+    If direction differs from direction(), the network has to be in dual direction mode
+    */
+    [[nodiscard]] std::span<const IndexT> get_neighbours( std::size_t agent_idx, EdgeDirection direction ) const
     {
-        return std::span( neighbour_list[agent_idx].data(), neighbour_list[agent_idx].size() );
+        return edges_in_direction( direction ).neighbours( agent_idx );
     }
 
     /*
     Gives a view into the edge weights going out/coming in at agent_idx
     */
-    [[nodiscard]] std::span<const WeightT> get_weights( std::size_t agent_idx ) const
+    [[nodiscard]] ConstWeightView get_weights( std::size_t agent_idx ) const
+    {
+        return edges.weights( agent_idx );
+    }
+
+    [[nodiscard]] WeightView get_weights( std::size_t agent_idx )
     {
-        return std::span<const WeightT>( weight_list[agent_idx].data(), weight_list[agent_idx].size() );
+        return edges.weights( agent_idx );
     }
 
-    [[nodiscard]] std::span<WeightT> get_weights( std::size_t agent_idx )
+    /*
+    Gives a view into the edge weights in the given direction.
+    If direction differs from direction(), the network has to be in dual direction mode
+    */
+    [[nodiscard]] ConstWeightView get_weights( std::size_t agent_idx, EdgeDirection direction ) const
     {
-        return std::span<WeightT>( weight_list[agent_idx].data(), weight_list[agent_idx].size() );
+        return edges_in_direction( direction ).weights( agent_idx );
     }
 
     /*
@@ -144,29 +586,51 @@ public:
     */
     void set_weights( std::size_t agent_idx, const std::span<const WeightT> weights )
     {
-        if( neighbour_list[agent_idx].size() != weights.size() )
+        static_assert( is_weighted, "Network::set_weights: an unweighted network has no weights to set" );
+
+        if( n_edges( agent_idx ) != weights.size() )
         {
             throw std::runtime_error( "Network::set_weights: tried to set weights of the wrong size!" );
         }
-        weight_list[agent_idx].assign( weights.begin(), weights.end() );
+
+        std::copy( weights.begin(), weights.end(), get_weights( agent_idx ).begin() );
+
+        if( dual_direction() )
+        {
+            // The k-th edge to a neighbour is the k-th occurrence of agent_idx in the row of the neighbour
+            auto neighbours = std::as_const( edges ).neighbours( agent_idx );
+            for( size_t i = 0; i < neighbours.size(); i++ )
+            {
+                auto occurrence       = std::count( neighbours.begin(), neighbours.begin() + i, neighbours[i] );
+                auto reverse_row      = reverse_edges.neighbours( neighbours[i] );
+                auto reverse_position = std::find( reverse_row.begin(), reverse_row.end(), agent_idx );
+                for( ; occurrence > 0; occurrence-- )
+                {
+                    reverse_position = std::find( reverse_position + 1, reverse_row.end(), agent_idx );
+                }
+                reverse_edges.weights( neighbours[i] )[reverse_position - reverse_row.begin()] = weights[i];
+            }
+        }
     }
 
     /*
     Sets the neighbour indices and sets the weight to a constant value at agent_idx
+    If the number of neighbours changes (or in dual direction mode), a CSR network is converted to adjacency lists
     */
     void set_neighbours_and_weights(
-        std::size_t agent_idx, std::span<const size_t> buffer_neighbours, const WeightT & weight )
+        std::size_t agent_idx, std::span<const IndexT> buffer_neighbours, const WeightT & weight )
     {
-        neighbour_list[agent_idx].assign( buffer_neighbours.begin(), buffer_neighbours.end() );
-        weight_list[agent_idx].resize( buffer_neighbours.size() );
-        std::fill( weight_list[agent_idx].begin(), weight_list[agent_idx].end(), weight );
+        remove_reverse_edges( agent_idx );
+        edges.set_row( agent_idx, buffer_neighbours, weight );
+        add_reverse_edges( agent_idx );
     }
 
     /*
     Sets the neighbour indices and weights at agent_idx
+    If the number of neighbours changes (or in dual direction mode), a CSR network is converted to adjacency lists
     */
     void set_neighbours_and_weights(
-        std::size_t agent_idx, std::span<const size_t> buffer_neighbours, std::span<const WeightT> buffer_weights )
+        std::size_t agent_idx, std::span<const IndexT> buffer_neighbours, std::span<const WeightT> buffer_weights )
     {
         if( buffer_neighbours.size() != buffer_weights.size() )
         {
@@ -174,21 +638,27 @@ public:
                 "Network::set_neighbours_and_weights: both buffers need to have the same length!" );
         }
 
-        neighbour_list[agent_idx].assign( buffer_neighbours.begin(), buffer_neighbours.end() );
-        weight_list[agent_idx].assign( buffer_weights.begin(), buffer_weights.end() );
+        remove_reverse_edges( agent_idx );
+        edges.set_row( agent_idx, buffer_neighbours, buffer_weights );
+        add_reverse_edges( agent_idx );
     }
 
     /*
     Adds an edge between agent_idx_i and agent_idx_j with weight w
+    A CSR network is converted to adjacency lists first (expensive)
     */
     void push_back_neighbour_and_weight( size_t agent_idx_i, size_t agent_idx_j, WeightT w )
     {
-        neighbour_list[agent_idx_i].push_back( agent_idx_j );
-        weight_list[agent_idx_i].push_back( w );
+        set_storage( StorageType::AdjacencyList );
+        edges.push_back( agent_idx_i, agent_idx_j, w );
+        if( dual_direction() )
+        {
+            reverse_edges.push_back( agent_idx_j, agent_idx_i, w );
+        }
     }
 
     /*
-    Transposes the network, without switching the direction flag (expensive).
+    Transposes the network, without switching the direction flag (expensive, unless in dual direction mode).
     Example: N(inc) -> N(inc)^T
     */
     void transpose()
@@ -198,27 +668,24 @@ public:
     }
 
     /*
-    Switches the direction flag *without* transposing the network (expensive)
+    Switches the direction flag *without* transposing the network (expensive, unless in dual direction mode)
     Example: N(inc) -> N(out)
+    The transpose is built with a counting sort (count the edges per agent, then scatter them), which runs on
+    several threads for large networks. Within each row, the neighbours end up sorted by index, independently of the
+    number of threads. The memory for the transpose is kept between calls, so repeated toggles do not reallocate.
     */
     void toggle_incoming_outgoing()
     {
-        std::vector<std::vector<size_t>> neighbour_list_transpose( n_agents(), std::vector<size_t>( 0 ) );
-        std::vector<std::vector<WeightT>> weight_list_transpose( n_agents(), std::vector<WeightT>( 0 ) );
-
-        for( size_t i_agent = 0; i_agent < n_agents(); i_agent++ )
+        if( dual_direction() )
         {
-            for( size_t i_neighbour = 0; i_neighbour < neighbour_list[i_agent].size(); i_neighbour++ )
-            {
-                const auto neighbour = neighbour_list[i_agent][i_neighbour];
-                const auto weight    = weight_list[i_agent][i_neighbour];
-                neighbour_list_transpose[neighbour].push_back( i_agent );
-                weight_list_transpose[neighbour].push_back( weight );
-            }
+            std::swap( edges, reverse_edges );
+        }
+        else
+        {
+            transpose_edges( edges, transpose_buffers.edges, transpose_buffers.counters );
+            // The old rows become the buffers for the next call
+            std::swap( edges, transpose_buffers.edges );
         }
-
-        neighbour_list = std::move( neighbour_list_transpose );
-        weight_list    = std::move( weight_list_transpose );
 
         // Swap the edge direction
         switch_direction_flag();
@@ -247,49 +714,10 @@ public:
     */
     void remove_double_counting()
     {
-        std::vector<size_t> sorting_indices{};
-
-        for( size_t idx_agent = 0; idx_agent < n_agents(); idx_agent++ )
+        edges.remove_double_counting();
+        if( dual_direction() )
         {
-
-            auto & neighbours = neighbour_list[idx_agent];
-            auto & weights    = weight_list[idx_agent];
-
-            std::vector<WeightT> weights_copy{};
-            std::vector<size_t> neighbours_copy{};
-
-            const auto n_neighbours = neighbours.size();
-
-            // First we will the sorting_indices array
-            sorting_indices.resize( n_neighbours );
-            std::iota( sorting_indices.begin(), sorting_indices.end(), 0 );
-
-            // Then, we figure out how to sort the neighbour indices list
-            std::sort(
-                sorting_indices.begin(), sorting_indices.end(),
-                [&]( auto i1, auto i2 ) { return neighbours[i1] < neighbours[i2]; } );
-
-            std::optional<size_t> last_neighbour_index = std::nullopt;
-            for( size_t i = 0; i < n_neighbours; i++ )
-            {
-                const auto sort_idx              = sorting_indices[i];
-                const auto current_neigbhour_idx = neighbours[sort_idx];
-                const auto current_weight        = weights[sort_idx];
-
-                if( last_neighbour_index != current_neigbhour_idx )
-                {
-                    weights_copy.push_back( current_weight );
-                    neighbours_copy.push_back( current_neigbhour_idx );
-                    last_neighbour_index = current_neigbhour_idx;
-                }
-                else
-                {
-                    weights_copy.back() += current_weight;
-                }
-            }
-
-            weight_list[idx_agent]    = weights_copy;
-            neighbour_list[idx_agent] = neighbours_copy;
+            reverse_edges.remove_double_counting();
         }
     }
 
@@ -298,17 +726,948 @@ public:
     */
     void clear()
     {
-        for( auto & w : weight_list )
-            w.clear();
-
-        for( auto & n : neighbour_list )
-            n.clear();
+        edges.clear();
+        if( dual_direction() )
+        {
+            reverse_edges.clear();
+        }
     }
 
 private:
-    std::vector<std::vector<size_t>> neighbour_list{}; // Neighbour list for the connections
-    std::vector<std::vector<WeightT>> weight_list{};   // List for the interaction weights of each connection
-    EdgeDirection _direction{};
+    /*
+    The edges of one direction, either as adjacency lists, in CSR format or fully connected (depending on type).
+    A fully connected storage only holds the shared row of neighbours in csr_neighbours, and the weights row by row.
+    */
+    struct EdgeStorage
+    {
+        StorageType type = StorageType::AdjacencyList;
+        std::vector<std::vector<IndexT>> neighbour_list{}; // Neighbour list for the connections
+        std::vector<std::vector<WeightT>> weight_list{};   // List for the interaction weights of each connection
+        std::vector<size_t> csr_offsets{};    // CSR: the edges of agent i are in [csr_offsets[i], csr_offsets[i+1])
+        std::vector<IndexT> csr_neighbours{}; // CSR: neighbour indices of all agents
+        std::vector<WeightT> csr_weights{};   // CSR: interaction weights of all agents
+        // For unweighted networks, weight_list and csr_weights stay empty
+        bool rows_sorted = true; // Whether the neighbours of every agent are sorted by index
+
+        EdgeStorage() = default;
+        EdgeStorage( size_t n_agents )
+                : neighbour_list( std::vector<std::vector<IndexT>>( n_agents, std::vector<IndexT>{} ) ),
+                  weight_list( std::vector<std::vector<WeightT>>( is_weighted ? n_agents : 0, std::vector<WeightT>{} ) )
+        {
+        }
+
+        [[nodiscard]] size_t n_rows() const
+        {
+            if( type == StorageType::FullyConnected )
+            {
+                return csr_neighbours.size();
+            }
+            return type == StorageType::CSR ? csr_offsets.size() - 1 : neighbour_list.size();
+        }
+
+        [[nodiscard]] size_t n_edges() const
+        {
+            if( type == StorageType::FullyConnected )
+            {
+                return csr_neighbours.size() * csr_neighbours.size();
+            }
+            if( type == StorageType::CSR )
+            {
+                return csr_neighbours.size();
+            }
+            return std::transform_reduce(
+                neighbour_list.cbegin(), neighbour_list.cend(), size_t( 0 ), std::plus{},
+                []( const auto & neigh_list ) { return neigh_list.size(); } );
+        }
+
+        [[nodiscard]] std::span<const IndexT> neighbours( size_t agent_idx ) const
+        {
+            if( type == StorageType::FullyConnected )
+            {
+                return std::span<const IndexT>( csr_neighbours.data(), csr_neighbours.size() );
+            }
+            if( type == StorageType::CSR )
+            {
+                return std::span<const IndexT>(
+                    csr_neighbours.data() + csr_offsets[agent_idx],
+                    csr_offsets[agent_idx + 1] - csr_offsets[agent_idx] );
+            }
+            return std::span( neighbour_list[agent_idx].data(), neighbour_list[agent_idx].size() );
+        }
+
+        // For a fully connected storage, this is the row shared by all agents, which the callers only read
+        [[nodiscard]] std::span<IndexT> neighbours( size_t agent_idx )
+        {
+            if( type == StorageType::FullyConnected )
+            {
+                return std::span<IndexT>( csr_neighbours.data(), csr_neighbours.size() );
+            }
+            if( type == StorageType::CSR )
+            {
+                return std::span<IndexT>(
+                    csr_neighbours.data() + csr_offsets[agent_idx],
+                    csr_offsets[agent_idx + 1] - csr_offsets[agent_idx] );
+            }
+            return std::span( neighbour_list[agent_idx].data(), neighbour_list[agent_idx].size() );
+        }
+
+        [[nodiscard]] ConstWeightView weights( size_t agent_idx ) const
+        {
+            if constexpr( !is_weighted )
+            {
+                return constant_weights( agent_idx );
+            }
+            else if( type == StorageType::FullyConnected )
+            {
+                return std::span<const WeightT>( csr_weights.data() + agent_idx * n_rows(), n_rows() );
+            }
+            else if( type == StorageType::CSR )
+            {
+                return std::span<const WeightT>(
+                    csr_weights.data() + csr_offsets[agent_idx], csr_offsets[agent_idx + 1] - csr_offsets[agent_idx] );
+            }
+            else
+            {
+                return std::span<const WeightT>( weight_list[agent_idx].data(), weight_list[agent_idx].size() );
+            }
+        }
+
+        [[nodiscard]] WeightView weights( size_t agent_idx )
+        {
+            if constexpr( !is_weighted )
+            {
+                return constant_weights( agent_idx );
+            }
+            else if( type == StorageType::FullyConnected )
+            {
+                return std::span<WeightT>( csr_weights.data() + agent_idx * n_rows(), n_rows() );
+            }
+            else if( type == StorageType::CSR )
+            {
+                return std::span<WeightT>(
+                    csr_weights.data() + csr_offsets[agent_idx], csr_offsets[agent_idx + 1] - csr_offsets[agent_idx] );
+            }
+            else
+            {
+                return std::span<WeightT>( weight_list[agent_idx].data(), weight_list[agent_idx].size() );
+            }
+        }
+
+        [[nodiscard]] ConstantView<WeightT> constant_weights( size_t agent_idx ) const
+        {
+            return ConstantView<WeightT>(
+                std::views::iota( size_t( 0 ), neighbours( agent_idx ).size() ), ConstantValue<WeightT>{ 1.0 } );
+        }
+
+        void set_row( size_t agent_idx, std::span<const IndexT> buffer_neighbours, const WeightT & weight )
+        {
+            rows_sorted = rows_sorted && std::is_sorted( buffer_neighbours.begin(), buffer_neighbours.end() );
+            if( type == StorageType::FullyConnected && !std::ranges::equal( buffer_neighbours, csr_neighbours ) )
+            {
+                convert( StorageType::AdjacencyList );
+            }
+
+            if( type != StorageType::AdjacencyList )
+            {
+                if( type == StorageType::FullyConnected )
+                {
+                    if constexpr( is_weighted )
+                    {
+                        std::fill( weights( agent_idx ).begin(), weights( agent_idx ).end(), weight );
+                    }
+                    return;
+                }
+                if( neighbours( agent_idx ).size() == buffer_neighbours.size() )
+                {
+                    std::copy( buffer_neighbours.begin(), buffer_neighbours.end(), neighbours( agent_idx ).begin() );
+                    if constexpr( is_weighted )
+                    {
+                        std::fill( weights( agent_idx ).begin(), weights( agent_idx ).end(), weight );
+                    }
+                    return;
+                }
+                convert( StorageType::AdjacencyList );
+            }
+
+            neighbour_list[agent_idx].assign( buffer_neighbours.begin(), buffer_neighbours.end() );
+            if constexpr( is_weighted )
+            {
+                weight_list[agent_idx].resize( buffer_neighbours.size() );
+                std::fill( weight_list[agent_idx].begin(), weight_list[agent_idx].end(), weight );
+            }
+        }
+
+        void set_row(
+            size_t agent_idx, std::span<const IndexT> buffer_neighbours, std::span<const WeightT> buffer_weights )
+        {
+            rows_sorted = rows_sorted && std::is_sorted( buffer_neighbours.begin(), buffer_neighbours.end() );
+            if( type == StorageType::FullyConnected && !std::ranges::equal( buffer_neighbours, csr_neighbours ) )
+            {
+                convert( StorageType::AdjacencyList );
+            }
+
+            if( type != StorageType::AdjacencyList )
+            {
+                if( type == StorageType::FullyConnected )
+                {
+                    if constexpr( is_weighted )
+                    {
+                        std::copy( buffer_weights.begin(), buffer_weights.end(), weights( agent_idx ).begin() );
+                    }
+                    return;
+                }
+                if( neighbours( agent_idx ).size() == buffer_neighbours.size() )
+                {
+                    std::copy( buffer_neighbours.begin(), buffer_neighbours.end(), neighbours( agent_idx ).begin() );
+                    if constexpr( is_weighted )
+                    {
+                        std::copy( buffer_weights.begin(), buffer_weights.end(), weights( agent_idx ).begin() );
+                    }
+                    return;
+                }
+                convert( StorageType::AdjacencyList );
+            }
+
+            neighbour_list[agent_idx].assign( buffer_neighbours.begin(), buffer_neighbours.end() );
+            if constexpr( is_weighted )
+            {
+                weight_list[agent_idx].assign( buffer_weights.begin(), buffer_weights.end() );
+            }
+        }
+
+        void push_back( size_t agent_idx_i, size_t agent_idx_j, WeightT w )
+        {
+            convert( StorageType::AdjacencyList );
+            auto & row  = neighbour_list[agent_idx_i];
+            rows_sorted = rows_sorted && ( row.empty() || row.back() <= agent_idx_j );
+            row.push_back( IndexT( agent_idx_j ) );
+            if constexpr( is_weighted )
+            {
+                weight_list[agent_idx_i].push_back( w );
+            }
+        }
+
+        [[nodiscard]] MemoryUsage memory_usage() const
+        {
+            MemoryUsage usage{};
+            usage.add( "neighbour_list", neighbour_list );
+            usage.add( "weight_list", weight_list );
+            usage.add( "csr_offsets", csr_offsets );
+            usage.add( "csr_neighbours", csr_neighbours );
+            usage.add( "csr_weights", csr_weights );
+            return usage;
+        }
+
+        /*
+        Gives the position of the first edge to neighbour_idx in the row of agent_idx, or nullopt if there is none
+        */
+        [[nodiscard]] std::optional<size_t> find( size_t agent_idx, size_t neighbour_idx ) const
+        {
+            if( type == StorageType::FullyConnected )
+            {
+                if( agent_idx >= n_rows() || neighbour_idx >= n_rows() )
+                {
+                    return std::nullopt;
+                }
+                return neighbour_idx;
+            }
+
+            auto row = neighbours( agent_idx );
+            auto it  = rows_sorted ? std::lower_bound( row.begin(), row.end(), neighbour_idx )
+                                   : std::find( row.begin(), row.end(), neighbour_idx );
+            if( it == row.end() || *it != neighbour_idx )
+            {
+                return std::nullopt;
+            }
+            return size_t( it - row.begin() );
+        }
+
+        /*
+        Checks if every row is sorted, e.g. after the rows have been set directly
+        */
+        void update_rows_sorted()
+        {
+            rows_sorted = true;
+            for( size_t idx_agent = 0; rows_sorted && idx_agent < n_rows(); idx_agent++ )
+            {
+                rows_sorted = std::is_sorted( neighbours( idx_agent ).begin(), neighbours( idx_agent ).end() );
+            }
+        }
+
+        void sort_rows()
+        {
+            if( rows_sorted )
+            {
+                return;
+            }
+
+            Parallel::for_each_chunk(
+                n_rows(),
+                [&]( size_t idx_begin, size_t idx_end, size_t )
+                {
+                    RowBuffer row_buffer{};
+                    for( size_t idx_agent = idx_begin; idx_agent < idx_end; idx_agent++ )
+                    {
+                        sort_row_by_index( neighbours( idx_agent ), weights( idx_agent ), row_buffer );
+                    }
+                },
+                Parallel::default_min_chunk_size / 16 );
+            rows_sorted = true;
+        }
+
+        /*
+        Removes all the edges to neighbour_idx from the row of agent_idx
+        */
+        void erase( size_t agent_idx, size_t neighbour_idx )
+        {
+            convert( StorageType::AdjacencyList );
+            auto & neighbours = neighbour_list[agent_idx];
+
+            size_t n_kept = 0;
+            for( size_t i = 0; i < neighbours.size(); i++ )
+            {
+                if( neighbours[i] != neighbour_idx )
+                {
+                    neighbours[n_kept] = neighbours[i];
+                    if constexpr( is_weighted )
+                    {
+                        weight_list[agent_idx][n_kept] = weight_list[agent_idx][i];
+                    }
+                    n_kept++;
+                }
+            }
+            neighbours.resize( n_kept );
+            if constexpr( is_weighted )
+            {
+                weight_list[agent_idx].resize( n_kept );
+            }
+        }
+
+        void clear()
+        {
+            rows_sorted = true;
+            if( type == StorageType::FullyConnected )
+            {
+                *this = EdgeStorage( n_rows() );
+                return;
+            }
+
+            if( type == StorageType::CSR )
+            {
+                std::fill( csr_offsets.begin(), csr_offsets.end(), 0 );
+                csr_neighbours.clear();
+                csr_weights.clear();
+                return;
+            }
+
+            for( auto & w : weight_list )
+                w.clear();
+
+            for( auto & n : neighbour_list )
+                n.clear();
+        }
+
+        void convert( StorageType new_type )
+        {
+            if( new_type == type )
+            {
+                return;
+            }
+
+            if( new_type == StorageType::FullyConnected )
+            {
+                convert_to_fully_connected();
+                return;
+            }
+
+            if( type == StorageType::FullyConnected )
+            {
+                expand_fully_connected();
+                if( new_type == StorageType::CSR )
+                {
+                    return;
+                }
+            }
+
+            if( new_type == StorageType::CSR )
+            {
+                const size_t n_agents = neighbour_list.size();
+                csr_offsets.resize( n_agents + 1 );
+                csr_offsets[0] = 0;
+                for( size_t idx_agent = 0; idx_agent < n_agents; idx_agent++ )
+                {
+                    csr_offsets[idx_agent + 1] = csr_offsets[idx_agent] + neighbour_list[idx_agent].size();
+                }
+
+                csr_neighbours.resize( csr_offsets.back() );
+                csr_weights.resize( is_weighted ? csr_offsets.back() : 0 );
+                for( size_t idx_agent = 0; idx_agent < n_agents; idx_agent++ )
+                {
+                    std::copy(
+                        neighbour_list[idx_agent].begin(), neighbour_list[idx_agent].end(),
+                        csr_neighbours.begin() + csr_offsets[idx_agent] );
+                    if constexpr( is_weighted )
+                    {
+                        std::copy(
+                            weight_list[idx_agent].begin(), weight_list[idx_agent].end(),
+                            csr_weights.begin() + csr_offsets[idx_agent] );
+                    }
+                }
+
+                // Release the memory held by the adjacency lists
+                neighbour_list = std::vector<std::vector<IndexT>>{};
+                weight_list    = std::vector<std::vector<WeightT>>{};
+            }
+            else
+            {
+                const size_t n_agents = csr_offsets.size() - 1;
+                neighbour_list.resize( n_agents );
+                weight_list.resize( is_weighted ? n_agents : 0 );
+                for( size_t idx_agent = 0; idx_agent < n_agents; idx_agent++ )
+                {
+                    neighbour_list[idx_agent].assign( neighbours( idx_agent ).begin(), neighbours( idx_agent ).end() );
+                    if constexpr( is_weighted )
+                    {
+                        weight_list[idx_agent].assign( weights( idx_agent ).begin(), weights( idx_agent ).end() );
+                    }
+                }
+
+                // Release the memory held by the CSR arrays
+                csr_offsets    = std::vector<size_t>{};
+                csr_neighbours = std::vector<IndexT>{};
+                csr_weights    = std::vector<WeightT>{};
+            }
+            type = new_type;
+        }
+
+        /*
+        Gives a copy with the rows and neighbour indices relabeled: row i is the old row new_order[i] and the
+        neighbour j becomes new_index[j]. A fully connected storage keeps its shared row and permutes the weights
+        */
+        [[nodiscard]] EdgeStorage permuted( std::span<const size_t> new_order, std::span<const IndexT> new_index ) const
+        {
+            const size_t n = n_rows();
+            EdgeStorage result{};
+            result.type        = type;
+            result.rows_sorted = type == StorageType::FullyConnected; // The relabeled neighbours are out of order
+
+            if( type == StorageType::FullyConnected )
+            {
+                result.csr_neighbours = csr_neighbours;
+                if constexpr( is_weighted )
+                {
+                    result.csr_weights.resize( n * n );
+                    Parallel::for_each_index(
+                        n,
+                        [&]( size_t i )
+                        {
+                            auto row = weights( new_order[i] );
+                            for( size_t j = 0; j < n; j++ )
+                            {
+                                result.csr_weights[i * n + j] = row[new_order[j]];
+                            }
+                        },
+                        std::max<size_t>( 1, Parallel::default_min_chunk_size / std::max<size_t>( 1, n ) ) );
+                }
+                return result;
+            }
+
+            // Make room for the rows, then fill them in parallel
+            if( type == StorageType::CSR )
+            {
+                result.csr_offsets.resize( n + 1 );
+                result.csr_offsets[0] = 0;
+                for( size_t i = 0; i < n; i++ )
+                {
+                    result.csr_offsets[i + 1] = result.csr_offsets[i] + neighbours( new_order[i] ).size();
+                }
+                result.csr_neighbours.resize( result.csr_offsets.back() );
+                result.csr_weights.resize( is_weighted ? result.csr_offsets.back() : 0 );
+            }
+            else
+            {
+                result.neighbour_list.resize( n );
+                result.weight_list.resize( is_weighted ? n : 0 );
+                for( size_t i = 0; i < n; i++ )
+                {
+                    result.neighbour_list[i].resize( neighbour_list[new_order[i]].size() );
+                    if constexpr( is_weighted )
+                    {
+                        result.weight_list[i] = weight_list[new_order[i]];
+                    }
+                }
+            }
+
+            Parallel::for_each_index(
+                n,
+                [&]( size_t i )
+                {
+                    auto old_neighbours = neighbours( new_order[i] );
+                    auto new_neighbours = result.neighbours( i );
+                    for( size_t k = 0; k < old_neighbours.size(); k++ )
+                    {
+                        new_neighbours[k] = new_index[old_neighbours[k]];
+                    }
+                    if constexpr( is_weighted )
+                    {
+                        if( type == StorageType::CSR )
+                        {
+                            auto old_weights = weights( new_order[i] );
+                            std::copy( old_weights.begin(), old_weights.end(), result.weights( i ).begin() );
+                        }
+                    }
+                } );
+
+            return result;
+        }
+
+        /*
+        Converts a fully connected storage to CSR, by writing out the shared row of neighbours for every agent.
+        The weights are already stored row by row
+        */
+        void expand_fully_connected()
+        {
+            const size_t n_agents = n_rows();
+            csr_offsets.resize( n_agents + 1 );
+            for( size_t idx_agent = 0; idx_agent <= n_agents; idx_agent++ )
+            {
+                csr_offsets[idx_agent] = idx_agent * n_agents;
+            }
+
+            csr_neighbours.resize( n_agents * n_agents );
+            for( size_t idx_agent = 1; idx_agent < n_agents; idx_agent++ )
+            {
+                std::copy(
+                    csr_neighbours.begin(), csr_neighbours.begin() + n_agents,
+                    csr_neighbours.begin() + csr_offsets[idx_agent] );
+            }
+            type = StorageType::CSR;
+        }
+
+        /*
+        Drops the neighbour indices, if every agent has the neighbours 0, 1, ..., n-1 in this order
+        */
+        void convert_to_fully_connected()
+        {
+            const size_t n_agents = n_rows();
+            for( size_t idx_agent = 0; idx_agent < n_agents; idx_agent++ )
+            {
+                auto row      = neighbours( idx_agent );
+                bool complete = row.size() == n_agents;
+                for( size_t i = 0; complete && i < row.size(); i++ )
+                {
+                    complete = row[i] == i;
+                }
+                if( !complete )
+                {
+                    throw std::runtime_error(
+                        "Network: only a complete graph, with every row sorted by index, can be stored as "
+                        "StorageType::FullyConnected!" );
+                }
+            }
+
+            convert( StorageType::CSR );
+            // The first row already holds the neighbours 0, 1, ..., n-1 and the weights are stored row by row
+            csr_neighbours.resize( n_agents );
+            csr_neighbours.shrink_to_fit();
+            csr_offsets = std::vector<size_t>{};
+            type        = StorageType::FullyConnected;
+        }
+
+        /*
+        Sorts the neighbours by index and removes doubly counted edges by summing the weights
+        (unweighted networks just keep one of the edges). The rows are processed in place and in parallel
+        */
+        void remove_double_counting()
+        {
+            if( type == StorageType::FullyConnected )
+            {
+                // Every row is sorted and has no duplicates already
+                return;
+            }
+
+            const size_t n = n_rows();
+            std::vector<size_t> n_edges_row( type == StorageType::CSR ? n : 0 ); // Only needed to compact CSR
+
+            Parallel::for_each_chunk(
+                n,
+                [&]( size_t idx_begin, size_t idx_end, size_t )
+                {
+                    RowBuffer row_buffer{};
+                    for( size_t idx_agent = idx_begin; idx_agent < idx_end; idx_agent++ )
+                    {
+                        const size_t n_kept
+                            = merge_double_edges( neighbours( idx_agent ), weights( idx_agent ), row_buffer );
+                        if( type == StorageType::CSR )
+                        {
+                            n_edges_row[idx_agent] = n_kept;
+                        }
+                        else
+                        {
+                            // Shrinking does not reallocate
+                            neighbour_list[idx_agent].resize( n_kept );
+                            if constexpr( is_weighted )
+                            {
+                                weight_list[idx_agent].resize( n_kept );
+                            }
+                        }
+                    }
+                },
+                Parallel::default_min_chunk_size / 16 ); // A row holds many edges, so fewer rows are worth a thread
+
+            if( type == StorageType::CSR )
+            {
+                // Move the remaining edges of every row to the front. A row only moves towards the front, so we
+                // never overwrite a row that has not been moved yet
+                size_t n_edges_kept = 0;
+                for( size_t idx_agent = 0; idx_agent < n; idx_agent++ )
+                {
+                    const size_t row_begin = csr_offsets[idx_agent];
+                    std::copy_n(
+                        csr_neighbours.begin() + row_begin, n_edges_row[idx_agent],
+                        csr_neighbours.begin() + n_edges_kept );
+                    if constexpr( is_weighted )
+                    {
+                        std::copy_n(
+                            csr_weights.begin() + row_begin, n_edges_row[idx_agent],
+                            csr_weights.begin() + n_edges_kept );
+                    }
+                    csr_offsets[idx_agent] = n_edges_kept;
+                    n_edges_kept += n_edges_row[idx_agent];
+                }
+                csr_offsets.back() = n_edges_kept;
+                csr_neighbours.resize( n_edges_kept );
+                csr_weights.resize( is_weighted ? n_edges_kept : 0 );
+            }
+            rows_sorted = true;
+        }
+    };
+
+    /*
+    Scratch memory for toggle_incoming_outgoing, kept between calls to avoid reallocations.
+    It holds no state of the network, so copies of a network start with empty buffers.
+    */
+    struct TransposeBuffers
+    {
+        EdgeStorage edges{};
+        std::vector<std::atomic<size_t>> counters{}; // Edges per row, then the insertion position within each row
+
+        TransposeBuffers() = default;
+        TransposeBuffers( const TransposeBuffers & ) {}
+        TransposeBuffers( TransposeBuffers && ) noexcept = default;
+        TransposeBuffers & operator=( const TransposeBuffers & )
+        {
+            return *this;
+        }
+        TransposeBuffers & operator=( TransposeBuffers && ) noexcept = default;
+        ~TransposeBuffers()                                          = default;
+    };
+
+    EdgeStorage edges{};         // The edges in direction()
+    EdgeStorage reverse_edges{}; // The edges in the other direction, only used in dual direction mode
+    TransposeBuffers transpose_buffers{};
+    EdgeDirection _direction{};
+    bool _dual_direction = false;
+    std::vector<IndexT> original_indices{}; // Index of every agent before permute_agents, empty if never permuted
+    std::vector<IndexT> current_indices{};  // Inverse of original_indices
+
+    void check_index_range() const
+    {
+        if( n_agents() > 0 && n_agents() - 1 > std::numeric_limits<IndexT>::max() )
+        {
+            throw std::runtime_error( fmt::format(
+                "Network: {} agents can not be indexed with a {} byte index type!", n_agents(), sizeof( IndexT ) ) );
+        }
+    }
+
+    [[nodiscard]] const EdgeStorage & edges_in_direction( EdgeDirection direction ) const
+    {
+        if( direction == _direction )
+        {
+            return edges;
+        }
+        if( !dual_direction() )
+        {
+            throw std::runtime_error( "Network: the other edge direction is only available in dual direction mode!" );
+        }
+        return reverse_edges;
+    }
+
+    /*
+    Gives the row and the position within the row of the (first) edge going from idx_from to idx_to
+    */
+    [[nodiscard]] std::optional<std::pair<size_t, size_t>> find_edge( size_t idx_from, size_t idx_to ) const
+    {
+        const size_t idx_row       = direction() == EdgeDirection::Outgoing ? idx_from : idx_to;
+        const size_t idx_neighbour = direction() == EdgeDirection::Outgoing ? idx_to : idx_from;
+
+        auto position = edges.find( idx_row, idx_neighbour );
+        if( !position.has_value() )
+        {
+            return std::nullopt;
+        }
+        return std::make_pair( idx_row, position.value() );
+    }
+
+    /*
+    Removes the reverse edges of the row agent_idx, before the row gets replaced.
+    The rows of the other direction change size, so a CSR network is converted to adjacency lists (expensive)
+    */
+    void remove_reverse_edges( size_t agent_idx )
+    {
+        if( !dual_direction() )
+        {
+            return;
+        }
+
+        set_storage( StorageType::AdjacencyList );
+        for( const auto & neighbour : std::as_const( edges ).neighbours( agent_idx ) )
+        {
+            reverse_edges.erase( neighbour, agent_idx );
+        }
+    }
+
+    /*
+    Adds the reverse edges of the row agent_idx, after it has been replaced
+    */
+    void add_reverse_edges( size_t agent_idx )
+    {
+        if( !dual_direction() )
+        {
+            return;
+        }
+
+        auto neighbours = std::as_const( edges ).neighbours( agent_idx );
+        auto weights    = get_weights( agent_idx );
+        for( size_t i = 0; i < neighbours.size(); i++ )
+        {
+            reverse_edges.push_back( neighbours[i], agent_idx, weights[i] );
+        }
+    }
+
+    /*
+    Writes the transpose of source into target with a counting sort, which runs on several threads for large
+    networks. Within each row, the neighbours end up sorted by index, independently of the number of threads.
+    The memory already held by target is reused.
+    */
+    static void transpose_edges(
+        const EdgeStorage & source, EdgeStorage & target, std::vector<std::atomic<size_t>> & counters )
+    {
+        const size_t n        = source.n_rows();
+        const bool csr        = source.type == StorageType::CSR;
+        const size_t n_chunks = Parallel::n_chunks( n );
+
+        if( target.type != source.type )
+        {
+            target      = EdgeStorage{};
+            target.type = source.type;
+        }
+        target.rows_sorted = true;
+
+        if( source.type == StorageType::FullyConnected )
+        {
+            transpose_fully_connected( source, target );
+            return;
+        }
+
+        // First pass: count the edges of every agent in the transpose
+        if( counters.size() != n )
+        {
+            counters = std::vector<std::atomic<size_t>>( n );
+        }
+        Parallel::for_each_index( n, [&]( size_t idx ) { counters[idx].store( 0, std::memory_order_relaxed ); } );
+        Parallel::for_each_chunk(
+            n,
+            [&]( size_t idx_begin, size_t idx_end, size_t )
+            {
+                for( size_t i_agent = idx_begin; i_agent < idx_end; i_agent++ )
+                {
+                    for( const auto & neighbour : source.neighbours( i_agent ) )
+                    {
+                        counters[neighbour].fetch_add( 1, std::memory_order_relaxed );
+                    }
+                }
+            } );
+
+        // Make room for the transposed rows. Afterwards, the counters hold the insertion position within each row
+        if( csr )
+        {
+            target.csr_offsets.resize( n + 1 );
+            target.csr_offsets[0] = 0;
+            for( size_t idx_agent = 0; idx_agent < n; idx_agent++ )
+            {
+                target.csr_offsets[idx_agent + 1] = target.csr_offsets[idx_agent] + counters[idx_agent].load();
+                counters[idx_agent].store( 0 );
+            }
+            target.csr_neighbours.resize( target.csr_offsets[n] );
+            target.csr_weights.resize( is_weighted ? target.csr_offsets[n] : 0 );
+        }
+        else
+        {
+            target.neighbour_list.resize( n );
+            target.weight_list.resize( is_weighted ? n : 0 );
+            Parallel::for_each_index(
+                n,
+                [&]( size_t idx_agent )
+                {
+                    target.neighbour_list[idx_agent].resize( counters[idx_agent].load() );
+                    if constexpr( is_weighted )
+                    {
+                        target.weight_list[idx_agent].resize( counters[idx_agent].load() );
+                    }
+                    counters[idx_agent].store( 0 );
+                } );
+        }
+
+        // Second pass: scatter the edges into the transposed rows
+        Parallel::for_each_chunk(
+            n,
+            [&]( size_t idx_begin, size_t idx_end, size_t )
+            {
+                for( size_t i_agent = idx_begin; i_agent < idx_end; i_agent++ )
+                {
+                    const auto neighbours = source.neighbours( i_agent );
+                    const auto weights    = source.weights( i_agent );
+                    for( size_t i_neighbour = 0; i_neighbour < neighbours.size(); i_neighbour++ )
+                    {
+                        const auto neighbour = neighbours[i_neighbour];
+                        const auto position  = counters[neighbour].fetch_add( 1, std::memory_order_relaxed );
+                        target.neighbours( neighbour )[position] = IndexT( i_agent );
+                        if constexpr( is_weighted )
+                        {
+                            target.weights( neighbour )[position] = weights[i_neighbour];
+                        }
+                    }
+                }
+            } );
+
+        // With several threads, the edges within a row arrive in arbitrary order, so we restore the serial order
+        if( n_chunks > 1 )
+        {
+            Parallel::for_each_chunk(
+                n,
+                [&]( size_t idx_begin, size_t idx_end, size_t )
+                {
+                    RowBuffer row_buffer{};
+                    for( size_t idx_agent = idx_begin; idx_agent < idx_end; idx_agent++ )
+                    {
+                        sort_row_by_index( target.neighbours( idx_agent ), target.weights( idx_agent ), row_buffer );
+                    }
+                } );
+        }
+    }
+
+    /*
+    The transpose of a complete graph has the same neighbours, so only the matrix of weights gets transposed.
+    This is done in tiles, so that both the reads and the writes stay in the cache
+    */
+    static void transpose_fully_connected( const EdgeStorage & source, EdgeStorage & target )
+    {
+        const size_t n = source.n_rows();
+        target.csr_neighbours.assign( source.csr_neighbours.begin(), source.csr_neighbours.end() );
+
+        if constexpr( is_weighted )
+        {
+            constexpr size_t tile_size = 64;
+            target.csr_weights.resize( n * n );
+            Parallel::for_each_chunk(
+                n,
+                [&]( size_t idx_begin, size_t idx_end, size_t )
+                {
+                    for( size_t j_tile = 0; j_tile < n; j_tile += tile_size )
+                    {
+                        const size_t j_end = std::min( n, j_tile + tile_size );
+                        for( size_t i = idx_begin; i < idx_end; i++ )
+                        {
+                            for( size_t j = j_tile; j < j_end; j++ )
+                            {
+                                target.csr_weights[i * n + j] = source.csr_weights[j * n + i];
+                            }
+                        }
+                    }
+                },
+                std::max<size_t>( 1, Parallel::default_min_chunk_size / std::max<size_t>( 1, n ) ) );
+        }
+    }
+
+    // The edges of one row while it gets sorted: the neighbour, the position of the edge in the row and its weight
+    using RowBuffer = std::vector<std::tuple<IndexT, size_t, WeightT>>;
+
+    /*
+    Sorts the edges of one row by neighbour index and merges the edges to the same neighbour into one, summing their
+    weights in the order in which they were stored. The remaining edges are moved to the front of the row and their
+    number is returned
+    */
+    static size_t merge_double_edges(
+        std::span<IndexT> neighbours, WeightView weights, RowBuffer & row_buffer )
+    {
+        sort_row_by_index( neighbours, weights, row_buffer );
+
+        size_t n_kept = 0;
+        for( size_t i = 0; i < neighbours.size(); i++ )
+        {
+            if( n_kept > 0 && neighbours[n_kept - 1] == neighbours[i] )
+            {
+                if constexpr( is_weighted )
+                {
+                    weights[n_kept - 1] += weights[i];
+                }
+                continue;
+            }
+
+            neighbours[n_kept] = neighbours[i];
+            if constexpr( is_weighted )
+            {
+                weights[n_kept] = weights[i];
+            }
+            n_kept++;
+        }
+        return n_kept;
+    }
+
+    /*
+    Stably sorts the edges of one row by neighbour index. The row_buffer is only used if the row is not sorted already.
+    Edges to the same neighbour keep their order through the position in the row, so an in-place std::sort suffices and
+    the buffer, which every thread reuses for all of its rows, is the only memory needed
+    */
+    static void sort_row_by_index(
+        std::span<IndexT> neighbours, WeightView weights, RowBuffer & row_buffer )
+    {
+        if( std::is_sorted( neighbours.begin(), neighbours.end() ) )
+        {
+            return;
+        }
+
+        if constexpr( !is_weighted )
+        {
+            std::sort( neighbours.begin(), neighbours.end() );
+            return;
+        }
+
+        row_buffer.resize( neighbours.size() );
+        for( size_t i = 0; i < neighbours.size(); i++ )
+        {
+            row_buffer[i] = { neighbours[i], i, weights[i] };
+        }
+
+        std::sort(
+            row_buffer.begin(), row_buffer.end(),
+            []( const auto & e1, const auto & e2 )
+            {
+                const auto & [neighbour_1, position_1, weight_1] = e1;
+                const auto & [neighbour_2, position_2, weight_2] = e2;
+                return neighbour_1 < neighbour_2 || ( neighbour_1 == neighbour_2 && position_1 < position_2 );
+            } );
+
+        for( size_t i = 0; i < neighbours.size(); i++ )
+        {
+            neighbours[i] = std::get<0>( row_buffer[i] );
+            if constexpr( is_weighted )
+            {
+                weights[i] = std::get<2>( row_buffer[i] );
+            }
+        }
+    }
 };
 
-} // namespace Seldon
\ No newline at end of file
+} // namespace Seldon
@@ -1,297 +1,1173 @@
 #pragma once
 #include "network.hpp"
+#include "network_io.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <numeric>
 #include <random>
+#include <span>
+#include <stdexcept>
+#include <string_view>
 #include <util/math.hpp>
 #include <util/misc.hpp>
+#include <util/parallel.hpp>
+#include <util/rng.hpp>
+#include <utility>
 #include <vector>
 
 namespace Seldon::NetworkGeneration
 {
-/* Constructs a new network with n_connections per agent
+
+/* Builds the CSR arrays of a network in two passes, so that the edges are written directly into their final storage:
+   first the number of neighbours of every agent is set (set_n_neighbours), then allocate() reserves the arrays and the
+   rows are filled through neighbours( idx_agent ) and weights( idx_agent ). Finally, build() moves the arrays into the
+   network. Different agents can be counted and filled from different threads.
+   For an unweighted network, no weights are stored and weights( idx_agent ) is empty
+*/
+template<typename NetworkT>
+class CSRBuilder
+{
+public:
+    using WeightT = typename NetworkT::WeightT;
+    using IndexT  = typename NetworkT::IndexT;
+
+    explicit CSRBuilder( size_t n_agents ) : offsets( n_agents + 1, 0 ) {}
+
+    [[nodiscard]] size_t n_agents() const
+    {
+        return offsets.size() - 1;
+    }
+
+    void set_n_neighbours( size_t idx_agent, size_t n_neighbours )
+    {
+        offsets[idx_agent + 1] = n_neighbours;
+    }
+
+    /*
+    Turns the numbers of neighbours into offsets and allocates the neighbours and weights
+    */
+    void allocate()
+    {
+        std::partial_sum( offsets.begin(), offsets.end(), offsets.begin() );
+        neighbour_storage.resize( offsets.back() );
+        if constexpr( NetworkT::is_weighted )
+        {
+            weight_storage.resize( offsets.back() );
+        }
+    }
+
+    [[nodiscard]] std::span<IndexT> neighbours( size_t idx_agent )
+    {
+        return std::span<IndexT>( neighbour_storage ).subspan( offsets[idx_agent], n_neighbours( idx_agent ) );
+    }
+
+    [[nodiscard]] std::span<WeightT> weights( size_t idx_agent )
+    {
+        if constexpr( !NetworkT::is_weighted )
+        {
+            return {};
+        }
+        return std::span<WeightT>( weight_storage ).subspan( offsets[idx_agent], n_neighbours( idx_agent ) );
+    }
+
+    [[nodiscard]] size_t n_neighbours( size_t idx_agent ) const
+    {
+        return offsets[idx_agent + 1] - offsets[idx_agent];
+    }
+
+    NetworkT build( typename NetworkT::EdgeDirection direction = NetworkT::EdgeDirection::Incoming )
+    {
+        return NetworkT(
+            std::move( offsets ), std::move( neighbour_storage ), std::move( weight_storage ), direction );
+    }
+
+private:
+    std::vector<size_t> offsets{};
+    std::vector<IndexT> neighbour_storage{};
+    std::vector<WeightT> weight_storage{};
+};
+
+/* Draws random weights for the neighbours of one agent, normalized so that they sum to 1
+*/
+template<typename WeightT, typename GeneratorT>
+void draw_normalized_weights( std::span<WeightT> incoming_neighbour_weights, GeneratorT & gen )
+{
+    std::uniform_real_distribution<> dis( 0.0, 1.0 ); // Values don't matter, will be normalized
+    WeightT outgoing_norm_weight = 0.0;
+
+    // Initialize the weights
+    for( auto & weight : incoming_neighbour_weights )
+    {
+        weight = dis( gen ); // Draw the weight
+        outgoing_norm_weight += weight;
+    }
+
+    // ---------
+    // Normalize the weights so that the row sums to 1
+    // Might be specific to the DeGroot model?
+    for( auto & weight : incoming_neighbour_weights )
+    {
+        weight /= outgoing_norm_weight;
+    }
+}
+
+/* Draws the incoming neighbours and weights of agent i_agent for generate_n_connections, into buffers of the size
+   given by n_connections_drawn. The weights are normalized, so that they sum to 1
+*/
+template<typename IndexT, typename WeightT, typename GeneratorT>
+void draw_n_connections(
+    size_t i_agent, size_t n_agents, bool self_interaction, std::span<IndexT> incoming_neighbour_buffer,
+    std::span<WeightT> incoming_neighbour_weights, GeneratorT & gen )
+{
+    // The self-interaction is the last entry
+    const size_t n_drawn = incoming_neighbour_buffer.size() - ( self_interaction ? 1 : 0 );
+
+    // Get the sorted adjacencies, excluding i (include i later)
+    // TODO: option for making the n_connections variable
+    draw_unique_from_n_into( i_agent, n_agents, incoming_neighbour_buffer.first( n_drawn ), gen );
+    if( self_interaction )
+    {
+        incoming_neighbour_buffer[n_drawn] = IndexT( i_agent ); // Add the agent itself
+    }
+
+    draw_normalized_weights( incoming_neighbour_weights, gen );
+}
+
+/* The number of neighbours of every agent in generate_n_connections
+*/
+inline size_t n_connections_drawn( size_t n_agents, size_t n_connections, bool self_interaction )
+{
+    return std::min( n_connections, n_agents > 0 ? n_agents - 1 : 0 ) + ( self_interaction ? 1 : 0 );
+}
+
+/* Constructs a new network with n_connections per agent, stored in CSR format
    If self_interaction=true, a connection of the agent with itself is included, which is *not* counted in n_connections
 */
-template<typename AgentType>
-Network<AgentType>
+template<typename AgentType, typename WeightType = double, typename IndexType = DefaultIndexT>
+Network<AgentType, WeightType, IndexType>
 generate_n_connections( size_t n_agents, size_t n_connections, bool self_interaction, std::mt19937 & gen )
 {
-    using NetworkT = Network<AgentType>;
+    using NetworkT = Network<AgentType, WeightType, IndexType>;
     using WeightT  = typename NetworkT::WeightT;
 
-    std::vector<std::vector<size_t>> neighbour_list;  // Neighbour list for the connections
-    std::vector<std::vector<WeightT>> weight_list;    // List for the interaction weights of each connection
-    std::uniform_real_distribution<> dis( 0.0, 1.0 ); // Values don't matter, will be normalized
-    auto incoming_neighbour_buffer
-        = std::vector<size_t>(); // for the j_agents indices connected to i_agent (adjacencies/neighbours)
-    auto incoming_neighbour_weights = std::vector<WeightT>(); // Vector of weights of the j neighbours of i
-    WeightT outgoing_norm_weight    = 0;
+    // Every agent has the same number of neighbours, so the edges can be drawn directly into the CSR arrays
+    const size_t n_neighbours = n_connections_drawn( n_agents, n_connections, self_interaction );
+    auto builder              = CSRBuilder<NetworkT>( n_agents );
+    for( size_t i_agent = 0; i_agent < n_agents; ++i_agent )
+    {
+        builder.set_n_neighbours( i_agent, n_neighbours );
+    }
+    builder.allocate();
+
+    // The weights are drawn even for unweighted networks, so that the neighbours do not depend on the WeightType
+    auto weight_buffer = std::vector<WeightT>( NetworkT::is_weighted ? 0 : n_neighbours );
 
-    // Loop through all the agents and create the neighbour_list and weight_list
+    // Loop through all the agents and fill their neighbours and weights
     for( size_t i_agent = 0; i_agent < n_agents; ++i_agent )
     {
-        outgoing_norm_weight = 0.0;
+        auto weights = NetworkT::is_weighted ? builder.weights( i_agent ) : std::span<WeightT>( weight_buffer );
+        draw_n_connections( i_agent, n_agents, self_interaction, builder.neighbours( i_agent ), weights, gen );
+    }
+
+    return builder.build();
+}
+
+/* Parallel version of generate_n_connections: every agent draws from its own stream (see RNGStreams), so the
+   network only depends on the seed of the streams and not on the number of threads
+*/
+template<typename AgentType, typename WeightType = double, typename IndexType = DefaultIndexT>
+Network<AgentType, WeightType, IndexType>
+generate_n_connections( size_t n_agents, size_t n_connections, bool self_interaction, const RNGStreams & streams )
+{
+    using NetworkT = Network<AgentType, WeightType, IndexType>;
+    using WeightT  = typename NetworkT::WeightT;
+
+    const size_t n_neighbours = n_connections_drawn( n_agents, n_connections, self_interaction );
+    auto builder              = CSRBuilder<NetworkT>( n_agents );
+    for( size_t i_agent = 0; i_agent < n_agents; ++i_agent )
+    {
+        builder.set_n_neighbours( i_agent, n_neighbours );
+    }
+    builder.allocate();
+
+    Parallel::for_each_chunk(
+        n_agents,
+        [&]( size_t idx_begin, size_t idx_end, size_t )
+        {
+            auto weight_buffer = std::vector<WeightT>( NetworkT::is_weighted ? 0 : n_neighbours );
+            for( size_t i_agent = idx_begin; i_agent < idx_end; ++i_agent )
+            {
+                auto gen     = streams.stream( i_agent );
+                auto weights = NetworkT::is_weighted ? builder.weights( i_agent ) : std::span<WeightT>( weight_buffer );
+                draw_n_connections( i_agent, n_agents, self_interaction, builder.neighbours( i_agent ), weights, gen );
+            }
+        } );
+
+    return builder.build();
+}
+
+/* Constructs a random directed network (Erdős–Rényi G(n,p)), in which every agent has every other agent as an
+   incoming neighbour with probability p, stored in CSR format.
+   If self_interaction=true, a connection of the agent with itself is included as the last entry of every row.
+   The weights are drawn and normalized as in generate_n_connections.
+   The neighbours are found by geometric skipping, so the cost is proportional to the number of edges. Every agent
+   draws from its own stream (see RNGStreams), which is replayed to first count and then fill its row, so the network
+   is the same for any number of threads
+*/
+template<typename AgentType, typename WeightType = double, typename IndexType = DefaultIndexT>
+Network<AgentType, WeightType, IndexType>
+generate_erdos_renyi( size_t n_agents, double p, bool self_interaction, const RNGStreams & streams )
+{
+    using NetworkT = Network<AgentType, WeightType, IndexType>;
+    using IndexT   = typename NetworkT::IndexT;
+
+    // Calls func for the incoming neighbours of i_agent, drawn from all agents except i_agent itself
+    auto for_each_neighbour = [&]( size_t i_agent, StreamRNG & gen, auto && func )
+    {
+        for_each_bernoulli_selected(
+            n_agents - 1, p, gen, [&]( size_t j ) { func( j >= i_agent ? j + 1 : j ); } );
+    };
+
+    auto builder = CSRBuilder<NetworkT>( n_agents );
+    Parallel::for_each_index(
+        n_agents,
+        [&]( size_t i_agent )
+        {
+            auto gen            = streams.stream( i_agent );
+            size_t n_neighbours = self_interaction ? 1 : 0;
+            for_each_neighbour( i_agent, gen, [&]( size_t ) { n_neighbours++; } );
+            builder.set_n_neighbours( i_agent, n_neighbours );
+        } );
+    builder.allocate();
+
+    Parallel::for_each_index(
+        n_agents,
+        [&]( size_t i_agent )
+        {
+            auto gen             = streams.stream( i_agent );
+            auto neighbours      = builder.neighbours( i_agent );
+            size_t idx_neighbour = 0;
+            for_each_neighbour( i_agent, gen, [&]( size_t j ) { neighbours[idx_neighbour++] = IndexT( j ); } );
+            if( self_interaction )
+            {
+                neighbours[idx_neighbour] = IndexT( i_agent );
+            }
+
+            if constexpr( NetworkT::is_weighted )
+            {
+                draw_normalized_weights( builder.weights( i_agent ), gen );
+            }
+        } );
+
+    return builder.build();
+}
+
+/* Constructs a stochastic block model, stored in CSR format: the agents are divided into consecutive blocks of the
+   sizes block_sizes, and an agent in block a has an agent in block b as an incoming neighbour with probability
+   probabilities[a][b] (the edges are directed, so probabilities does not have to be symmetric).
+   If self_interaction=true, a connection of the agent with itself is included as the last entry of every row.
+   The weights are drawn and normalized as in generate_n_connections.
+   The rows are processed in chunks that do not cross block boundaries. For every chunk and block b, the pairs
+   (row, agent in b) are sampled with geometric skipping from their own stream (see RNGStreams), which is replayed
+   to first count and then fill the rows. So the cost is O(E + B * n_chunks), where n_chunks >= B, and the network
+   does not depend on the number of threads
+*/
+template<typename AgentType, typename WeightType = double, typename IndexType = DefaultIndexT>
+Network<AgentType, WeightType, IndexType> generate_stochastic_block_model(
+    const std::vector<size_t> & block_sizes, const std::vector<std::vector<double>> & probabilities,
+    bool self_interaction, const RNGStreams & streams )
+{
+    using NetworkT = Network<AgentType, WeightType, IndexType>;
+    using IndexT   = typename NetworkT::IndexT;
+
+    const size_t n_blocks = block_sizes.size();
+    if( probabilities.size() != n_blocks
+        || std::ranges::any_of( probabilities, [&]( const auto & row ) { return row.size() != n_blocks; } ) )
+    {
+        throw std::runtime_error(
+            "generate_stochastic_block_model: probabilities has to be an n_blocks x n_blocks matrix!" );
+    }
+    for( const auto & row : probabilities )
+    {
+        if( std::ranges::any_of( row, []( double p ) { return p < 0.0 || p > 1.0; } ) )
+        {
+            throw std::runtime_error( "generate_stochastic_block_model: the probabilities have to be in [0, 1]!" );
+        }
+    }
+
+    // The first agent of every block, and the chunks of rows
+    constexpr size_t rows_per_chunk = 1024;
+    std::vector<size_t> block_offsets( n_blocks + 1, 0 );
+    std::vector<std::pair<size_t, size_t>> chunks{}; // (block, first row)
+    for( size_t idx_block = 0; idx_block < n_blocks; idx_block++ )
+    {
+        block_offsets[idx_block + 1] = block_offsets[idx_block] + block_sizes[idx_block];
+        for( size_t row = block_offsets[idx_block]; row < block_offsets[idx_block + 1]; row += rows_per_chunk )
+        {
+            chunks.emplace_back( idx_block, row );
+        }
+    }
+    const size_t n_agents = block_offsets.back();
+
+    // Calls func( row, neighbour ) for the edges of the chunk from block idx_block, ordered by row and neighbour.
+    // Every chunk uses n_blocks + 1 streams, the last one for the weights
+    auto for_each_edge_in_chunk = [&]( size_t idx_chunk, size_t idx_block, auto && func )
+    {
+        const auto [row_block, row_begin] = chunks[idx_chunk];
+        const size_t n_rows               = std::min( rows_per_chunk, block_offsets[row_block + 1] - row_begin );
+        const size_t n_columns            = block_sizes[idx_block];
+        const double p                    = probabilities[row_block][idx_block];
+
+        auto gen = streams.stream( idx_chunk * ( n_blocks + 1 ) + idx_block );
+        for_each_bernoulli_selected(
+            n_rows * n_columns, p, gen,
+            [&]( size_t idx_pair )
+            {
+                const size_t row       = row_begin + idx_pair / n_columns;
+                const size_t neighbour = block_offsets[idx_block] + idx_pair % n_columns;
+                if( row != neighbour )
+                {
+                    func( row, neighbour );
+                }
+            } );
+    };
+
+    auto builder = CSRBuilder<NetworkT>( n_agents );
+    Parallel::for_each_index(
+        chunks.size(),
+        [&]( size_t idx_chunk )
+        {
+            const auto [row_block, row_begin] = chunks[idx_chunk];
+            const size_t row_end              = std::min( row_begin + rows_per_chunk, block_offsets[row_block + 1] );
+            std::vector<size_t> n_neighbours( row_end - row_begin, self_interaction ? 1 : 0 );
+            for( size_t idx_block = 0; idx_block < n_blocks; idx_block++ )
+            {
+                for_each_edge_in_chunk(
+                    idx_chunk, idx_block, [&]( size_t row, size_t ) { n_neighbours[row - row_begin]++; } );
+            }
+            for( size_t row = row_begin; row < row_end; row++ )
+            {
+                builder.set_n_neighbours( row, n_neighbours[row - row_begin] );
+            }
+        },
+        1 );
+    builder.allocate();
+
+    Parallel::for_each_index(
+        chunks.size(),
+        [&]( size_t idx_chunk )
+        {
+            const auto [row_block, row_begin] = chunks[idx_chunk];
+            const size_t row_end              = std::min( row_begin + rows_per_chunk, block_offsets[row_block + 1] );
+            std::vector<size_t> n_filled( row_end - row_begin, 0 );
+            for( size_t idx_block = 0; idx_block < n_blocks; idx_block++ )
+            {
+                for_each_edge_in_chunk(
+                    idx_chunk, idx_block, [&]( size_t row, size_t neighbour )
+                    { builder.neighbours( row )[n_filled[row - row_begin]++] = IndexT( neighbour ); } );
+            }
+
+            auto gen = streams.stream( idx_chunk * ( n_blocks + 1 ) + n_blocks );
+            for( size_t row = row_begin; row < row_end; row++ )
+            {
+                if( self_interaction )
+                {
+                    builder.neighbours( row ).back() = IndexT( row );
+                }
+                if constexpr( NetworkT::is_weighted )
+                {
+                    draw_normalized_weights( builder.weights( row ), gen );
+                }
+            }
+        },
+        1 );
+
+    return builder.build();
+}
+
+/* Constructs a scale-free network by preferential attachment (Barabási–Albert model), stored in CSR format.
+   The first n_connections+1 agents form a complete graph. Every further agent connects to n_connections distinct
+   earlier agents, each chosen with a probability proportional to its current number of neighbours, so that the
+   degrees follow a power law with exponent 3. The edges are undirected, i.e. every edge is stored in both rows.
+   The endpoints of all edges are kept in one array, in which every agent appears once per neighbour, so drawing an
+   agent proportionally to its degree is a uniform draw from that array, and the whole network is built in O(E).
+   If self_interaction=true, a connection of the agent with itself is included as the last entry of every row.
+   The weights are drawn and normalized as in generate_n_connections
+*/
+template<typename AgentType, typename WeightType = double, typename IndexType = DefaultIndexT>
+Network<AgentType, WeightType, IndexType>
+generate_barabasi_albert( size_t n_agents, size_t n_connections, bool self_interaction, std::mt19937 & gen )
+{
+    using NetworkT = Network<AgentType, WeightType, IndexType>;
+    using IndexT   = typename NetworkT::IndexT;
+
+    const size_t n_seed_agents = n_connections + 1;
+    if( n_agents < n_seed_agents )
+    {
+        throw std::runtime_error( "generate_barabasi_albert: n_agents has to be larger than n_connections!" );
+    }
 
-        incoming_neighbour_buffer.clear();
-        incoming_neighbour_weights.clear();
+    // Edge e connects the agents endpoints[2e] and endpoints[2e+1]
+    std::vector<IndexT> endpoints{};
+    endpoints.reserve( 2 * ( n_seed_agents * n_connections / 2 + ( n_agents - n_seed_agents ) * n_connections ) );
+    for( size_t i_agent = 0; i_agent < n_seed_agents; ++i_agent )
+    {
+        for( size_t j_agent = 0; j_agent < i_agent; ++j_agent )
+        {
+            endpoints.push_back( IndexT( i_agent ) );
+            endpoints.push_back( IndexT( j_agent ) );
+        }
+    }
 
-        // Get the vector of sorted adjacencies, excluding i (include i later)
-        // TODO: option for making the n_connections variable
-        draw_unique_k_from_n( i_agent, n_connections, n_agents, incoming_neighbour_buffer, gen );
+    // The agent that last chose each agent as a neighbour (the seed agents never choose), to reject duplicates in O(1)
+    std::vector<IndexT> chosen_by( n_agents, 0 );
+    std::vector<IndexT> targets( n_connections );
+    for( size_t i_agent = n_seed_agents; i_agent < n_agents; ++i_agent )
+    {
+        // Only the edges of the earlier agents take part
+        std::uniform_int_distribution<size_t> dist( 0, endpoints.size() - 1 );
+        for( auto & target : targets )
+        {
+            do
+            {
+                target = endpoints[dist( gen )];
+            } while( chosen_by[target] == i_agent );
+            chosen_by[target] = IndexT( i_agent );
+        }
 
-        incoming_neighbour_weights.resize( incoming_neighbour_buffer.size() );
-        for( size_t j = 0; j < incoming_neighbour_buffer.size(); ++j )
+        for( auto target : targets )
         {
-            incoming_neighbour_weights[j] = dis( gen ); // Draw the weight
-            outgoing_norm_weight += incoming_neighbour_weights[j];
+            endpoints.push_back( IndexT( i_agent ) );
+            endpoints.push_back( target );
         }
+    }
+    std::vector<IndexT>().swap( chosen_by );
+
+    // Count the neighbours of every agent and scatter the edges into their rows
+    std::vector<size_t> n_neighbours( n_agents, 0 );
+    for( auto idx_agent : endpoints )
+    {
+        n_neighbours[idx_agent]++;
+    }
 
+    auto builder = CSRBuilder<NetworkT>( n_agents );
+    for( size_t i_agent = 0; i_agent < n_agents; ++i_agent )
+    {
+        builder.set_n_neighbours( i_agent, n_neighbours[i_agent] + ( self_interaction ? 1 : 0 ) );
+        n_neighbours[i_agent] = 0;
+    }
+    builder.allocate();
+
+    for( size_t idx = 0; idx < endpoints.size(); idx += 2 )
+    {
+        const auto i_agent = endpoints[idx];
+        const auto j_agent = endpoints[idx + 1];
+        builder.neighbours( i_agent )[n_neighbours[i_agent]++] = j_agent;
+        builder.neighbours( j_agent )[n_neighbours[j_agent]++] = i_agent;
+    }
+    std::vector<IndexT>().swap( endpoints );
+
+    for( size_t i_agent = 0; i_agent < n_agents; ++i_agent )
+    {
+        auto neighbours = builder.neighbours( i_agent );
+        std::sort( neighbours.begin(), neighbours.begin() + n_neighbours[i_agent] );
         if( self_interaction )
         {
-            // Put the self-interaction as the last entry
-            auto self_interaction_weight = dis( gen );
-            outgoing_norm_weight += self_interaction_weight;
-            // outgoing_norm_weights += self_interaction_weight;
-            incoming_neighbour_buffer.push_back( i_agent ); // Add the agent itself
-            incoming_neighbour_weights.push_back( self_interaction_weight );
+            neighbours.back() = IndexT( i_agent );
         }
 
-        // ---------
-        // Normalize the weights so that the row sums to 1
-        // Might be specific to the DeGroot model?
-        for( size_t j = 0; j < incoming_neighbour_buffer.size(); ++j )
+        if constexpr( NetworkT::is_weighted )
         {
-            incoming_neighbour_weights[j] /= outgoing_norm_weight;
+            draw_normalized_weights( builder.weights( i_agent ), gen );
         }
+    }
 
-        // Add the neighbour vector for i_agent to the neighbour list
-        neighbour_list.push_back( incoming_neighbour_buffer );
-        // Add the weight interactions for the neighbours of i_agent
-        weight_list.push_back( incoming_neighbour_weights );
+    return builder.build();
+}
 
-    } // end of loop through n_agents
+// @TODO generate_fully_connected does not need to be overloaded..perhaps a std::optional instead to reduce code duplication?
+/* Constructs a complete graph (including self-interactions) with a constant weight.
+   The neighbour indices are not stored (StorageType::FullyConnected), but the weights are, one per edge
+*/
+template<typename AgentType, typename WeightType = double, typename IndexType = DefaultIndexT>
+Network<AgentType, WeightType, IndexType>
+generate_fully_connected( size_t n_agents, typename Network<AgentType, WeightType, IndexType>::WeightT weight = 0.0 )
+{
+    using NetworkT = Network<AgentType, WeightType, IndexType>;
+    using WeightT  = typename NetworkT::WeightT;
+
+    // The weights of all agents, row by row. An unweighted network does not store any
+    auto weights = std::vector<WeightT>( NetworkT::is_weighted ? n_agents * n_agents : 0, weight );
 
-    return NetworkT( std::move( neighbour_list ), std::move( weight_list ), NetworkT::EdgeDirection::Incoming );
+    return NetworkT( n_agents, std::move( weights ), NetworkT::EdgeDirection::Incoming );
 }
 
-// @TODO generate_fully_connected does not need to be overloaded..perhaps a std::optional instead to reduce code duplication?
-template<typename AgentType>
-Network<AgentType> generate_fully_connected( size_t n_agents, typename Network<AgentType>::WeightT weight = 0.0 )
+/* Constructs a complete graph (including self-interactions) with random weights, normalized for every agent.
+   The neighbour indices are not stored (StorageType::FullyConnected)
+*/
+template<typename AgentType, typename WeightType = double, typename IndexType = DefaultIndexT>
+Network<AgentType, WeightType, IndexType> generate_fully_connected( size_t n_agents, std::mt19937 & gen )
 {
-    using NetworkT = Network<AgentType>;
+    using NetworkT = Network<AgentType, WeightType, IndexType>;
     using WeightT  = typename NetworkT::WeightT;
 
-    std::vector<std::vector<size_t>> neighbour_list; // Neighbour list for the connections
-    std::vector<std::vector<WeightT>> weight_list;   // List for the interaction weights of each connection
-    auto incoming_neighbour_buffer
-        = std::vector<size_t>( n_agents ); // for the j_agents indices connected to i_agent (adjacencies/neighbours)
-    auto incoming_neighbour_weights
-        = std::vector<WeightT>( n_agents, weight ); // Vector of weights of the j neighbours of i
+    std::vector<WeightT> weights; // The weights of all agents, row by row
+    auto incoming_neighbour_weights = std::vector<WeightT>( n_agents ); // Vector of weights of the j neighbours of i
 
-    // Create the incoming_neighbour_buffer once. This will contain all agents, including itself
-    for( size_t i_agent = 0; i_agent < n_agents; ++i_agent )
+    if constexpr( NetworkT::is_weighted )
     {
-        incoming_neighbour_buffer[i_agent] = i_agent;
+        weights.reserve( n_agents * n_agents );
     }
 
-    // Loop through all the agents and update the neighbour_list and weight_list
+    // Loop through all the agents and create the weights
     for( size_t i_agent = 0; i_agent < n_agents; ++i_agent )
     {
-        // Add the neighbour vector for i_agent to the neighbour list
-        neighbour_list.push_back( incoming_neighbour_buffer );
+        draw_normalized_weights( std::span<WeightT>( incoming_neighbour_weights ), gen );
+
         // Add the weight interactions for the neighbours of i_agent
-        weight_list.push_back( incoming_neighbour_weights );
+        if constexpr( NetworkT::is_weighted )
+        {
+            weights.insert( weights.end(), incoming_neighbour_weights.begin(), incoming_neighbour_weights.end() );
+        }
 
     } // end of loop through n_agents
 
-    return NetworkT( std::move( neighbour_list ), std::move( weight_list ), NetworkT::EdgeDirection::Incoming );
+    return NetworkT( n_agents, std::move( weights ), NetworkT::EdgeDirection::Incoming );
+}
+
+/* Parallel version of generate_fully_connected with random weights: every agent draws from its own stream (see
+   RNGStreams), so the network only depends on the seed of the streams and not on the number of threads
+*/
+template<typename AgentType, typename WeightType = double, typename IndexType = DefaultIndexT>
+Network<AgentType, WeightType, IndexType> generate_fully_connected( size_t n_agents, const RNGStreams & streams )
+{
+    using NetworkT = Network<AgentType, WeightType, IndexType>;
+    using WeightT  = typename NetworkT::WeightT;
+
+    // An unweighted network has nothing to draw
+    std::vector<WeightT> weights( NetworkT::is_weighted ? n_agents * n_agents : 0 ); // The weights, row by row
+
+    if constexpr( NetworkT::is_weighted )
+    {
+        Parallel::for_each_index(
+            n_agents,
+            [&]( size_t i_agent )
+            {
+                auto gen = streams.stream( i_agent );
+                auto row = std::span<WeightT>( weights ).subspan( i_agent * n_agents, n_agents );
+                draw_normalized_weights( row, gen );
+            },
+            std::max<size_t>( 1, Parallel::default_min_chunk_size / std::max<size_t>( 1, n_agents ) ) );
+    }
+
+    return NetworkT( n_agents, std::move( weights ), NetworkT::EdgeDirection::Incoming );
+}
+
+/* Copies the array of values.size() numbers of type FileT, which starts at bytes (not necessarily aligned), into
+   values, converting them to ValueT
+*/
+template<typename FileT, typename ValueT>
+void copy_binary_array( const char * bytes, std::vector<ValueT> & values )
+{
+    Parallel::for_each_chunk(
+        values.size(),
+        [&]( size_t idx_begin, size_t idx_end, size_t )
+        {
+            if constexpr( std::is_same_v<FileT, ValueT> )
+            {
+                std::memcpy(
+                    values.data() + idx_begin, bytes + idx_begin * sizeof( FileT ),
+                    ( idx_end - idx_begin ) * sizeof( FileT ) );
+            }
+            else
+            {
+                for( size_t idx = idx_begin; idx < idx_end; idx++ )
+                {
+                    FileT value{};
+                    std::memcpy( &value, bytes + idx * sizeof( FileT ), sizeof( FileT ) );
+                    values[idx] = ValueT( value );
+                }
+            }
+        },
+        Parallel::default_min_chunk_size * 16 );
 }
 
-template<typename AgentType>
-Network<AgentType> generate_fully_connected( size_t n_agents, std::mt19937 & gen )
+/* Checks if all of the n numbers of type FileT, which start at bytes (not necessarily aligned), are below bound
+*/
+template<typename FileT>
+bool binary_array_below( const char * bytes, size_t n, size_t bound )
 {
-    using NetworkT = Network<AgentType>;
+    std::atomic<bool> below = true;
+    Parallel::for_each_chunk(
+        n,
+        [&]( size_t idx_begin, size_t idx_end, size_t )
+        {
+            for( size_t idx = idx_begin; idx < idx_end; idx++ )
+            {
+                FileT value{};
+                std::memcpy( &value, bytes + idx * sizeof( FileT ), sizeof( FileT ) );
+                if( value >= bound )
+                {
+                    below = false;
+                    return;
+                }
+            }
+        },
+        Parallel::default_min_chunk_size * 16 );
+    return below;
+}
+
+/* Loads a network from a file in the binary format (see BinaryNetworkHeader and network_to_binary_file).
+   The file is mapped into memory and its arrays are copied into the CSR arrays of the network in parallel, converting
+   the indices and weights if their types differ. Loading is therefore not zero-copy: the network owns its arrays and
+   the mapping is closed afterwards, which costs one pass over the data and the memory of the arrays. The file is
+   validated, so that a broken file can not give a broken network. Unweighted files give the weight 1 to every edge
+*/
+template<typename AgentType, typename WeightType = double, typename IndexType = DefaultIndexT>
+Network<AgentType, WeightType, IndexType> generate_from_binary_file( const std::string & file )
+{
+    using NetworkT = Network<AgentType, WeightType, IndexType>;
     using WeightT  = typename NetworkT::WeightT;
+    using IndexT   = typename NetworkT::IndexT;
 
-    std::vector<std::vector<size_t>> neighbour_list; // Neighbour list for the connections
-    std::vector<std::vector<WeightT>> weight_list;   // List for the interaction weights of each connection
-    auto incoming_neighbour_buffer
-        = std::vector<size_t>( n_agents ); // for the j_agents indices connected to i_agent (adjacencies/neighbours)
-    std::uniform_real_distribution<> dis( 0.0, 1.0 );                   // Values don't matter, will be normalized
-    auto incoming_neighbour_weights = std::vector<WeightT>( n_agents ); // Vector of weights of the j neighbours of i
-    WeightT outgoing_norm_weight    = 0;
+    const auto mapped_file = MappedFile( file );
+    const auto bytes       = mapped_file.contents();
 
-    // Create the incoming_neighbour_buffer once. This will contain all agents, including itself
-    for( size_t i_agent = 0; i_agent < n_agents; ++i_agent )
+    BinaryNetworkHeader header{};
+    if( bytes.size() >= sizeof( header ) )
+    {
+        std::memcpy( &header, bytes.data(), sizeof( header ) );
+    }
+    if( bytes.size() < sizeof( header ) || header.magic != BinaryNetworkHeader::expected_magic )
+    {
+        throw std::runtime_error( fmt::format( "{} is not a binary network file!", file ) );
+    }
+    if( header.version != BinaryNetworkHeader::current_version )
     {
-        incoming_neighbour_buffer[i_agent] = i_agent;
+        throw std::runtime_error( fmt::format( "{} has the unsupported version {}!", file, header.version ) );
+    }
+    const bool valid_index_bytes  = header.index_bytes == 4 || header.index_bytes == 8;
+    const bool valid_weight_bytes = header.weight_bytes == 0 || header.weight_bytes == 4 || header.weight_bytes == 8;
+    if( !valid_index_bytes || !valid_weight_bytes || header.direction > 1 )
+    {
+        throw std::runtime_error( fmt::format( "{} has an invalid header!", file ) );
+    }
+    // The numbers of agents and edges are bounded first, so that the expected file size can not overflow
+    if( header.n_agents >= bytes.size() || header.n_edges > bytes.size() || bytes.size() != header.file_size() )
+    {
+        throw std::runtime_error( fmt::format( "{} has the wrong size, it might be truncated!", file ) );
     }
 
-    // Loop through all the agents and create the neighbour_list and weight_list
-    for( size_t i_agent = 0; i_agent < n_agents; ++i_agent )
+    const size_t n_agents = header.n_agents;
+    const size_t n_edges  = header.n_edges;
+
+    std::vector<size_t> offsets( n_agents + 1 );
+    copy_binary_array<std::uint64_t>( bytes.data() + header.offsets_begin(), offsets );
+    if( offsets.front() != 0 || offsets.back() != n_edges || !std::ranges::is_sorted( offsets ) )
     {
+        throw std::runtime_error( fmt::format( "{} has invalid offsets!", file ) );
+    }
 
-        outgoing_norm_weight = 0.0;
+    // All neighbours have to be agents. This is checked before the conversion, which could wrap large indices around
+    const char * neighbour_bytes = bytes.data() + header.neighbours_begin();
+    std::vector<IndexT> neighbours( n_edges );
+    bool valid_neighbours = false;
+    if( header.index_bytes == 4 )
+    {
+        valid_neighbours = binary_array_below<std::uint32_t>( neighbour_bytes, n_edges, n_agents );
+        copy_binary_array<std::uint32_t>( neighbour_bytes, neighbours );
+    }
+    else
+    {
+        valid_neighbours = binary_array_below<std::uint64_t>( neighbour_bytes, n_edges, n_agents );
+        copy_binary_array<std::uint64_t>( neighbour_bytes, neighbours );
+    }
+    if( !valid_neighbours )
+    {
+        throw std::runtime_error( fmt::format( "{} has neighbours that are not agents!", file ) );
+    }
 
-        // Initialize the weights
-        for( size_t j = 0; j < n_agents; ++j )
+    std::vector<WeightT> weights{};
+    if constexpr( NetworkT::is_weighted )
+    {
+        weights.resize( n_edges, WeightT( 1.0 ) );
+        if( header.weight_bytes == 4 )
         {
-            incoming_neighbour_weights[j] = dis( gen ); // Draw the weight
-            outgoing_norm_weight += incoming_neighbour_weights[j];
+            copy_binary_array<float>( bytes.data() + header.weights_begin(), weights );
         }
-
-        // ---------
-        // Normalize the weights so that the row sums to 1
-        // Might be specific to the DeGroot model?
-        for( size_t j = 0; j < incoming_neighbour_buffer.size(); ++j )
+        else if( header.weight_bytes == 8 )
         {
-            incoming_neighbour_weights[j] /= outgoing_norm_weight;
+            copy_binary_array<double>( bytes.data() + header.weights_begin(), weights );
         }
+    }
 
-        // Add the neighbour vector for i_agent to the neighbour list
-        neighbour_list.push_back( incoming_neighbour_buffer );
-        // Add the weight interactions for the neighbours of i_agent
-        weight_list.push_back( incoming_neighbour_weights );
-
-    } // end of loop through n_agents
-
-    return NetworkT( std::move( neighbour_list ), std::move( weight_list ), NetworkT::EdgeDirection::Incoming );
+    const auto direction
+        = header.direction == 0 ? NetworkT::EdgeDirection::Incoming : NetworkT::EdgeDirection::Outgoing;
+    return NetworkT( std::move( offsets ), std::move( neighbours ), std::move( weights ), direction );
 }
 
-template<typename AgentType>
-Network<AgentType> generate_from_file( const std::string & file )
+/* Loads a network from a file. Files in the binary format are detected and loaded with generate_from_binary_file,
+   all other files are read as text, with one line per agent: the index of the agent, the number of its incoming
+   neighbours, their indices and their weights. Lines starting with '#' are comments and an empty line ends the data.
+   The text is parsed in parallel, in line-aligned chunks, and the rows are stored in CSR format
+*/
+template<typename AgentType, typename WeightType = double, typename IndexType = DefaultIndexT>
+Network<AgentType, WeightType, IndexType> generate_from_file( const std::string & file )
 {
-    using NetworkT = Network<AgentType>;
+    if( is_binary_network_file( file ) )
+    {
+        return generate_from_binary_file<AgentType, WeightType, IndexType>( file );
+    }
+
+    using NetworkT = Network<AgentType, WeightType, IndexType>;
     using WeightT  = typename NetworkT::WeightT;
-    std::vector<std::vector<size_t>> neighbour_list; // Neighbour list for the connections
-    std::vector<std::vector<WeightT>> weight_list;   // List for the interaction weights of each connection
+    using IndexT   = typename NetworkT::IndexT;
 
-    std::string file_contents = get_file_contents( file );
+    // The rows parsed from one chunk of the file
+    struct ParsedRows
+    {
+        std::vector<size_t> n_neighbours{};
+        std::vector<IndexT> neighbours{};
+        std::vector<WeightT> weights{};
+    };
 
-    // bool finished = false;
-    size_t start_of_line = 0;
-    bool finished        = false;
-    while( !finished )
+    auto parse_row = []( std::string_view line, ParsedRows & rows )
     {
-        // Find the end of the current line
-        auto end_of_line = file_contents.find( '\n', start_of_line );
-        if( end_of_line == std::string::npos )
+        const size_t n_edges_before = rows.neighbours.size();
+        size_t n_neighbours         = 0;
+        size_t n_weights            = 0;
+
+        // First column is idx_agent (does not get used), the second column contains the number of incoming
+        // neighbours, the next n_neighbours columns contain the neighbour indices and the rest are the weights
+        auto parse_column = [&]( size_t idx_column, std::string_view column )
         {
-            finished = true;
+            if( idx_column == 1 )
+            {
+                n_neighbours = parse_number<size_t>( column );
+            }
+            else if( idx_column >= 2 && idx_column < 2 + n_neighbours )
+            {
+                rows.neighbours.push_back( parse_number<IndexT>( column ) );
+            }
+            else if( idx_column >= 2 + n_neighbours )
+            {
+                n_weights++;
+                // Unweighted networks ignore the weights
+                if constexpr( NetworkT::is_weighted )
+                {
+                    rows.weights.push_back( parse_number<WeightT>( column ) );
+                }
+            }
+        };
+        for_each_column( line, parse_column );
+
+        if( rows.neighbours.size() - n_edges_before != n_neighbours
+            || ( NetworkT::is_weighted && n_weights != n_neighbours ) )
+        {
+            throw std::runtime_error( fmt::format(
+                "Network file: the line '{}' needs an index and a weight for each of its {} neighbours", line,
+                n_neighbours ) );
         }
+        rows.n_neighbours.push_back( n_neighbours );
+    };
 
-        // Get the current line as a substring
-        auto line     = file_contents.substr( start_of_line, end_of_line - start_of_line );
-        start_of_line = end_of_line + 1;
+    const MappedFile file_mapping( file );
+    const auto bytes  = file_mapping.contents();
+    const auto chunks
+        = parse_lines_in_parallel<ParsedRows>( std::string_view( bytes.data(), bytes.size() ), parse_row );
 
-        if( line.empty() )
+    // Stitch the rows of the chunks together, in order
+    std::vector<size_t> chunk_agents_begin( chunks.size() + 1, 0 );
+    std::vector<size_t> chunk_edges_begin( chunks.size() + 1, 0 );
+    for( size_t idx_chunk = 0; idx_chunk < chunks.size(); idx_chunk++ )
+    {
+        chunk_agents_begin[idx_chunk + 1] = chunk_agents_begin[idx_chunk] + chunks[idx_chunk].n_neighbours.size();
+        chunk_edges_begin[idx_chunk + 1]  = chunk_edges_begin[idx_chunk] + chunks[idx_chunk].neighbours.size();
+    }
+
+    std::vector<size_t> offsets( chunk_agents_begin.back() + 1 );
+    std::vector<IndexT> neighbours( chunk_edges_begin.back() );
+    std::vector<WeightT> weights( NetworkT::is_weighted ? chunk_edges_begin.back() : 0 );
+    offsets.back() = chunk_edges_begin.back();
+
+    auto copy_chunk = [&]( size_t idx_chunk )
+    {
+        const auto & rows = chunks[idx_chunk];
+        size_t offset     = chunk_edges_begin[idx_chunk];
+        for( size_t idx_row = 0; idx_row < rows.n_neighbours.size(); idx_row++ )
         {
-            break;
+            offsets[chunk_agents_begin[idx_chunk] + idx_row] = offset;
+            offset += rows.n_neighbours[idx_row];
         }
+        std::copy( rows.neighbours.begin(), rows.neighbours.end(), neighbours.begin() + chunk_edges_begin[idx_chunk] );
+        std::copy( rows.weights.begin(), rows.weights.end(), weights.begin() + chunk_edges_begin[idx_chunk] );
+    };
+    Parallel::for_each_index( chunks.size(), copy_chunk, 1 );
+
+    return NetworkT(
+        std::move( offsets ), std::move( neighbours ), std::move( weights ), NetworkT::EdgeDirection::Incoming );
+}
+
+/* Gives the neighbour number idx_neighbour (0: left, 1: right, 2: down, 3: up) of the agent idx_agent on a square
+   lattice of edge length n_edge (with PBCs). The agent at the lattice site (i, j) has the index i + n_edge * j
+*/
+inline size_t square_lattice_neighbour( size_t idx_agent, size_t idx_neighbour, size_t n_edge )
+{
+    const size_t i = idx_agent % n_edge;
+    const size_t j = idx_agent / n_edge;
+
+    switch( idx_neighbour )
+    {
+        case 0: return ( i + n_edge - 1 ) % n_edge + n_edge * j;
+        case 1: return ( i + 1 ) % n_edge + n_edge * j;
+        case 2: return i + n_edge * ( ( j + n_edge - 1 ) % n_edge );
+        default: return i + n_edge * ( ( j + 1 ) % n_edge );
+    }
+}
+
+/* The neighbourhood of every site of a periodic lattice in d dimensions, with extents[k] sites along dimension k.
+   The site with the coordinates (x_0, x_1, ...) has the index x_0 + extents[0] * (x_1 + extents[1] * (x_2 + ...)).
+   The neighbours of a site are all sites within the distance radius, measured with the L1 norm (von Neumann
+   neighbourhood) or the maximum norm (Moore neighbourhood). They are stored once, as a stencil of offsets, so that
+   the neighbours of a site can be computed on the fly instead of being stored for every site.
+   The neighbours are ordered by their L1 distance, then by the highest dimension in which they are displaced,
+   negative before positive offsets. For the square lattice, this is the order of square_lattice_neighbour.
+   Every extent has to be at least 2*radius+1, otherwise some neighbours would coincide (or be the site itself)
+*/
+class LatticeStencil
+{
+public:
+    enum class Neighbourhood
+    {
+        VonNeumann,
+        Moore
+    };
 
-        if( line[0] == '#' )
+    LatticeStencil( std::vector<size_t> extents, Neighbourhood neighbourhood, size_t radius )
+            : extents( std::move( extents ) )
+    {
+        const size_t n_dims = this->extents.size();
+        if( n_dims == 0 || std::ranges::find( this->extents, 0 ) != this->extents.end() )
         {
-            continue;
+            throw std::runtime_error( "LatticeStencil: the lattice needs at least one site in every dimension!" );
+        }
+        if( std::ranges::any_of( this->extents, [&]( size_t extent ) { return extent < 2 * radius + 1; } ) )
+        {
+            throw std::runtime_error( "LatticeStencil: the lattice is too small for the radius of the neighbourhood!" );
         }
 
-        // Parse the columns
-        neighbour_list.emplace_back( 0 );
-        weight_list.emplace_back( 0 );
-
-        //@TODO: refactor with util/parse_comma_separated_list
-        size_t start_of_column = 0;
-        bool finished_row      = false;
-        size_t idx_column      = 0;
-        size_t n_neighbours    = 0;
-        while( !finished_row )
+        strides.resize( n_dims );
+        size_t stride = 1;
+        for( size_t k = 0; k < n_dims; k++ )
         {
-            auto end_of_column = line.find( ',', start_of_column );
+            strides[k] = stride;
+            stride *= this->extents[k];
+        }
 
-            if( end_of_column == std::string::npos )
+        // Go through all offsets in [-radius, radius]^d and keep those within the neighbourhood
+        std::vector<std::vector<long>> offsets{};
+        std::vector<long> offset( n_dims, -long( radius ) );
+        while( true )
+        {
+            size_t norm_l1  = 0;
+            size_t norm_max = 0;
+            for( auto o : offset )
             {
-                finished_row = true;
+                norm_l1 += size_t( std::abs( o ) );
+                norm_max = std::max( norm_max, size_t( std::abs( o ) ) );
+            }
+            const size_t norm = neighbourhood == Neighbourhood::VonNeumann ? norm_l1 : norm_max;
+            if( norm >= 1 && norm <= radius )
+            {
+                offsets.push_back( offset );
             }
 
-            auto column_substring = line.substr( start_of_column, end_of_column - start_of_column );
-            start_of_column       = end_of_column + 1;
-
-            // First column is idx_agent (does not get used)
-            if( idx_column == 1 ) // Second column contains the number of incoming neighbours
+            // Next offset, with the first dimension running fastest
+            size_t k = 0;
+            while( k < n_dims && offset[k] == long( radius ) )
             {
-                n_neighbours = std::stoi( column_substring );
+                offset[k++] = -long( radius );
             }
-            else if(
-                ( idx_column >= 2 )
-                && ( idx_column < 2 + n_neighbours ) ) // The next n_neighbours columsn contain the neighbour indices
+            if( k == n_dims )
             {
-                const auto idx_neighbour = std::stoi( column_substring );
-                neighbour_list.back().push_back( idx_neighbour );
+                break;
             }
-            else if( idx_column >= 2 + n_neighbours )
-            { // The rest of the columns are the weights
-                const auto weight = std::stod( column_substring );
-                weight_list.back().push_back( weight );
+            offset[k]++;
+        }
+
+        // Compares (L1 distance, highest displaced dimension, offsets from the highest dimension down)
+        auto sort_key = []( const std::vector<long> & o )
+        {
+            long norm_l1     = 0;
+            long highest_dim = 0;
+            for( size_t k = 0; k < o.size(); k++ )
+            {
+                norm_l1 += std::abs( o[k] );
+                highest_dim = o[k] != 0 ? long( k ) : highest_dim;
+            }
+            std::vector<long> key = { norm_l1, highest_dim };
+            key.insert( key.end(), o.rbegin(), o.rend() );
+            return key;
+        };
+        std::ranges::sort( offsets, {}, sort_key );
+
+        // Store the offsets as shifts modulo the extents, so that they never become negative
+        shifts.reserve( offsets.size() * n_dims );
+        for( const auto & o : offsets )
+        {
+            for( size_t k = 0; k < n_dims; k++ )
+            {
+                const long extent = long( this->extents[k] );
+                shifts.push_back( size_t( ( o[k] % extent + extent ) % extent ) );
             }
-            idx_column++;
         }
     }
 
-    return NetworkT( std::move( neighbour_list ), std::move( weight_list ), NetworkT::EdgeDirection::Incoming );
-}
+    [[nodiscard]] size_t n_dimensions() const
+    {
+        return extents.size();
+    }
 
-/* Constructs a new network on a square lattice of edge length n_edge (with PBCs)*/
-template<typename AgentType>
-Network<AgentType> generate_square_lattice( size_t n_edge, typename Network<AgentType>::WeightT weight = 0.0 )
-{
-    using NetworkT = Network<AgentType>;
-    using WeightT  = typename NetworkT::WeightT;
-    auto n_agents  = n_edge * n_edge;
+    [[nodiscard]] size_t n_sites() const
+    {
+        return strides.back() * extents.back();
+    }
 
-    // Create an empty Network
-    auto network = NetworkT( n_agents );
+    [[nodiscard]] size_t n_neighbours() const
+    {
+        return shifts.size() / n_dimensions();
+    }
 
-    auto wrap_edge_index = [&]( int k )
+    /*
+    Gives the neighbour number idx_neighbour of the site idx_site
+    */
+    [[nodiscard]] size_t neighbour( size_t idx_site, size_t idx_neighbour ) const
     {
-        if( k >= int( n_edge ) )
+        const size_t n_dims = n_dimensions();
+        size_t result       = 0;
+        for( size_t k = 0; k < n_dims; k++ )
         {
-            return k - int( n_edge );
+            size_t x = ( idx_site / strides[k] ) % extents[k] + shifts[idx_neighbour * n_dims + k];
+            if( x >= extents[k] )
+            {
+                x -= extents[k];
+            }
+            result += x * strides[k];
         }
-        else if( k < 0 )
+        return result;
+    }
+
+private:
+    std::vector<size_t> extents{};
+    std::vector<size_t> strides{}; // The index distance of neighbouring sites along every dimension
+    std::vector<size_t> shifts{};  // shifts[idx_neighbour * n_dimensions + k]: the offset along k, modulo extents[k]
+};
+
+/* Constructs a new network on a periodic lattice, in which the neighbours of every site are given by the stencil,
+   stored in CSR format. The neighbours of every agent are ordered as in the stencil
+*/
+template<typename AgentType, typename WeightType = double, typename IndexType = DefaultIndexT>
+Network<AgentType, WeightType, IndexType> generate_lattice(
+    const LatticeStencil & stencil, typename Network<AgentType, WeightType, IndexType>::WeightT weight = 0.0 )
+{
+    using NetworkT = Network<AgentType, WeightType, IndexType>;
+    using IndexT   = typename NetworkT::IndexT;
+
+    // Every agent has the same number of neighbours, so we can directly fill the CSR arrays
+    const size_t n_agents     = stencil.n_sites();
+    const size_t n_neighbours = stencil.n_neighbours();
+    auto builder              = CSRBuilder<NetworkT>( n_agents );
+    for( size_t i_agent = 0; i_agent < n_agents; i_agent++ )
+    {
+        builder.set_n_neighbours( i_agent, n_neighbours );
+    }
+    builder.allocate();
+
+    Parallel::for_each_index(
+        n_agents,
+        [&]( size_t i_agent )
         {
-            return int( n_edge ) + k;
-        }
-        else
+            auto neighbours = builder.neighbours( i_agent );
+            for( size_t idx_neighbour = 0; idx_neighbour < n_neighbours; idx_neighbour++ )
+            {
+                neighbours[idx_neighbour] = IndexT( stencil.neighbour( i_agent, idx_neighbour ) );
+            }
+            std::ranges::fill( builder.weights( i_agent ), weight );
+        } );
+
+    return builder.build();
+}
+
+/* Constructs a new network on a square lattice of edge length n_edge (with PBCs), stored in CSR format
+   The neighbours of every agent are ordered as in square_lattice_neighbour
+*/
+template<typename AgentType, typename WeightType = double, typename IndexType = DefaultIndexT>
+Network<AgentType, WeightType, IndexType>
+generate_square_lattice( size_t n_edge, typename Network<AgentType, WeightType, IndexType>::WeightT weight = 0.0 )
+{
+    const auto stencil = LatticeStencil( { n_edge, n_edge }, LatticeStencil::Neighbourhood::VonNeumann, 1 );
+    return generate_lattice<AgentType, WeightType, IndexType>( stencil, weight );
+}
+
+/* Constructs a new network on a ring of n_agents (with PBCs), in which every agent has the n_neighbours_per_side
+   closest agents on either side as neighbours, stored in CSR format. The neighbours of every agent are ordered by
+   distance, left before right
+*/
+template<typename AgentType, typename WeightType = double, typename IndexType = DefaultIndexT>
+Network<AgentType, WeightType, IndexType> generate_ring_lattice(
+    size_t n_agents, size_t n_neighbours_per_side,
+    typename Network<AgentType, WeightType, IndexType>::WeightT weight = 0.0 )
+{
+    if( 2 * n_neighbours_per_side >= n_agents && n_neighbours_per_side > 0 )
+    {
+        throw std::runtime_error( "generate_ring_lattice: the ring is too small for the number of neighbours!" );
+    }
+
+    const auto stencil
+        = LatticeStencil( { n_agents }, LatticeStencil::Neighbourhood::VonNeumann, n_neighbours_per_side );
+    return generate_lattice<AgentType, WeightType, IndexType>( stencil, weight );
+}
+
+/* Counts how often every agent occurs in a row of neighbours, in a hash table with linear probing that is reused
+   from row to row. Agents are never removed from the table, their count drops to zero instead
+*/
+class NeighbourCounts
+{
+public:
+    // Starts over with the agents in row, leaving room for as many other agents to be added
+    template<typename IndexT>
+    void reset( std::span<const IndexT> row )
+    {
+        const size_t table_size = std::bit_ceil( 4 * row.size() + 4 );
+        shift                   = size_t( 64 - std::countr_zero( table_size ) );
+        keys.assign( table_size, empty_key );
+        counts.assign( table_size, 0 );
+        for( const auto & idx_agent : row )
         {
-            return k;
+            add( idx_agent );
         }
-    };
+    }
 
-    auto linear_index = [&]( int i, int j )
+    [[nodiscard]] bool contains( size_t idx_agent ) const
     {
-        auto idx = wrap_edge_index( i ) + n_edge * wrap_edge_index( j );
-        return idx;
-    };
+        return counts[slot( idx_agent )] > 0;
+    }
 
-    for( int i = 0; i < int( n_edge ); i++ )
+    void add( size_t idx_agent )
     {
-        // other edge
-        for( int j = 0; j < int( n_edge ); j++ )
-        {
-            // Central agent
-            auto central_index = linear_index( i, j );
+        const size_t idx_slot = slot( idx_agent );
+        keys[idx_slot]        = idx_agent;
+        counts[idx_slot]++;
+    }
+
+    void remove( size_t idx_agent )
+    {
+        counts[slot( idx_agent )]--;
+    }
 
-            // clang-format off
-            std::vector<size_t> neighbours = {
-                linear_index( i - 1, j ), 
-                linear_index( i + 1, j ), 
-                linear_index( i, j - 1 ),
-                linear_index( i, j + 1 )
-            };
+private:
+    static constexpr size_t empty_key = std::numeric_limits<size_t>::max();
+    std::vector<size_t> keys{};
+    std::vector<size_t> counts{};
+    size_t shift = 0; // Fibonacci hashing keeps the highest log2(table size) bits of the product
 
-            // clang-format on
-            network.set_neighbours_and_weights( central_index, neighbours, weight );
+    // The slot of idx_agent, or the empty slot where it would be added
+    [[nodiscard]] size_t slot( size_t idx_agent ) const
+    {
+        const size_t mask = keys.size() - 1;
+        size_t idx_slot   = size_t( ( uint64_t( idx_agent ) * 11400714819323198485ull ) >> shift );
+        while( keys[idx_slot] != empty_key && keys[idx_slot] != idx_agent )
+        {
+            idx_slot = ( idx_slot + 1 ) & mask;
         }
+        return idx_slot;
     }
+};
+
+/* Rewires every edge of the network with probability p (Watts–Strogatz), in place: the edge from agent j into the row
+   of agent i is replaced by an edge from an agent drawn uniformly among those that are not yet neighbours of i (and
+   not i itself). The weight stays with the edge and self-interactions are never rewired, so the number of neighbours
+   of every agent is kept. The rows are sorted afterwards.
+   The edges to rewire are found by geometric skipping and the current neighbours of an agent are kept in a hash table
+   (see NeighbourCounts), so the cost is proportional to the number of edges. Every agent draws from its own stream
+   (see RNGStreams), so the rows are rewired in parallel and the result does not depend on the number of threads
+*/
+template<typename NetworkT>
+void rewire_edges( NetworkT & network, double p, const RNGStreams & streams )
+{
+    using IndexT = typename NetworkT::IndexT;
 
+    // Every agent of a complete graph is connected to all others already
+    if( network.storage() == NetworkT::StorageType::FullyConnected )
+    {
+        return;
+    }
+
+    const size_t n_agents = network.n_agents();
+    network.bulk_update(
+        [&]()
+        {
+            Parallel::for_each_chunk(
+                n_agents,
+                [&]( size_t idx_begin, size_t idx_end, size_t )
+                {
+                    NeighbourCounts neighbour_counts{};
+                    for( size_t i_agent = idx_begin; i_agent < idx_end; i_agent++ )
+                    {
+                        auto neighbours = network.get_neighbours( i_agent );
+                        neighbour_counts.reset( std::span<const IndexT>( neighbours ) );
+
+                        // If the agent is connected to all others, there is nothing to rewire to
+                        const size_t n_other_neighbours
+                            = neighbours.size() - ( neighbour_counts.contains( i_agent ) ? 1 : 0 );
+                        if( n_other_neighbours + 1 >= n_agents )
+                        {
+                            continue;
+                        }
+
+                        auto gen = streams.stream( i_agent );
+                        std::uniform_int_distribution<size_t> dist( 0, n_agents - 1 );
+                        for_each_bernoulli_selected(
+                            neighbours.size(), p, gen,
+                            [&]( size_t idx_neighbour )
+                            {
+                                if( neighbours[idx_neighbour] == i_agent )
+                                {
+                                    return;
+                                }
+                                size_t j_agent = 0;
+                                do
+                                {
+                                    j_agent = dist( gen );
+                                } while( j_agent == i_agent || neighbour_counts.contains( j_agent ) );
+                                neighbour_counts.remove( neighbours[idx_neighbour] );
+                                neighbour_counts.add( j_agent );
+                                neighbours[idx_neighbour] = IndexT( j_agent );
+                            } );
+                    }
+                },
+                Parallel::default_min_chunk_size / 16 );
+        } );
+    network.sort_rows();
+}
+
+/* Constructs a small-world network (Watts–Strogatz): a ring lattice with n_neighbours_per_side neighbours on either
+   side of every agent, whose edges are rewired with probability p (see rewire_edges)
+*/
+template<typename AgentType, typename WeightType = double, typename IndexType = DefaultIndexT>
+Network<AgentType, WeightType, IndexType> generate_watts_strogatz(
+    size_t n_agents, size_t n_neighbours_per_side, double p, const RNGStreams & streams,
+    typename Network<AgentType, WeightType, IndexType>::WeightT weight = 0.0 )
+{
+    auto network
+        = generate_ring_lattice<AgentType, WeightType, IndexType>( n_agents, n_neighbours_per_side, weight );
+    rewire_edges( network, p, streams );
     return network;
 }
 } // namespace Seldon::NetworkGeneration
\ No newline at end of file
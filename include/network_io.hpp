@@ -1,16 +1,91 @@
 #pragma once
 #include "fstream"
 #include "network.hpp"
+#include "util/misc.hpp"
+#include <fmt/compile.h>
 #include <fmt/core.h>
+#include <fmt/format.h>
 #include <fmt/ostream.h>
 #include <fmt/ranges.h>
+#include <array>
+#include <bit>
 #include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <vector>
 namespace Seldon
 {
 
-template<typename AgentT>
-void network_to_dot_file( const Network<AgentT> & network, const std::string & file_path )
+/*
+    The header of the binary network format, which holds a network in CSR format (see Network):
+        header (64 bytes)
+        offsets:    (n_agents + 1) x uint64, the edges of agent i are in [offsets[i], offsets[i+1])
+        neighbours: n_edges x unsigned integer of index_bytes bytes
+        padding to a multiple of 8 bytes
+        weights:    n_edges x floating point number of weight_bytes bytes (none for unweighted networks)
+    All numbers are little-endian. The arrays are aligned, so that they could be used directly from a memory mapping,
+    but NetworkGeneration::generate_from_binary_file copies them out of the mapping into the arrays of the network
+*/
+struct BinaryNetworkHeader
+{
+    static constexpr std::array<char, 8> expected_magic = { 'S', 'E', 'L', 'D', 'O', 'N', 'N', 'W' };
+    static constexpr std::uint32_t current_version      = 1;
+
+    std::array<char, 8> magic  = expected_magic;
+    std::uint32_t version      = current_version;
+    std::uint32_t direction    = 0; // 0: incoming, 1: outgoing edges
+    std::uint32_t index_bytes  = 0; // 4 or 8
+    std::uint32_t weight_bytes = 0; // 0 (unweighted), 4 or 8
+    std::uint64_t n_agents     = 0;
+    std::uint64_t n_edges      = 0;
+    std::array<std::uint64_t, 3> reserved{};
+
+    [[nodiscard]] size_t offsets_begin() const
+    {
+        return sizeof( BinaryNetworkHeader );
+    }
+
+    [[nodiscard]] size_t neighbours_begin() const
+    {
+        return offsets_begin() + ( n_agents + 1 ) * sizeof( std::uint64_t );
+    }
+
+    [[nodiscard]] size_t weights_begin() const
+    {
+        const size_t neighbours_end = neighbours_begin() + n_edges * index_bytes;
+        return ( neighbours_end + 7 ) / 8 * 8;
+    }
+
+    [[nodiscard]] size_t file_size() const
+    {
+        return weights_begin() + n_edges * weight_bytes;
+    }
+};
+static_assert( sizeof( BinaryNetworkHeader ) == 64 );
+static_assert(
+    std::endian::native == std::endian::little, "The binary network format is only implemented for little-endian" );
+
+/*
+    Returns true, if the file starts like a network in the binary format
+*/
+inline bool is_binary_network_file( const std::string & file_path )
+{
+    std::ifstream fs( file_path, std::ios::binary );
+    std::array<char, 8> magic{};
+    fs.read( magic.data(), magic.size() );
+    return fs && magic == BinaryNetworkHeader::expected_magic;
+}
+
+/*
+    The writers below use the original indices of the agents (see Network::permute_agents) and write the agents in
+    their original order, so the output does not depend on how the agents are labeled internally.
+*/
+
+template<typename AgentT, typename WeightT, typename IndexT>
+void network_to_dot_file( const Network<AgentT, WeightT, IndexT> & network, const std::string & file_path )
 {
     std::fstream fs;
     fs.open( file_path, std::fstream::in | std::fstream::out | std::fstream::trunc );
@@ -18,16 +93,16 @@ void network_to_dot_file( const Network<AgentT> & network, const std::string & f
     size_t n_agents = network.n_agents();
     fmt::print( fs, "digraph G {{\n" );
 
-    for( size_t idx_agent = 0; idx_agent < n_agents; idx_agent++ )
+    for( size_t idx_original = 0; idx_original < n_agents; idx_original++ )
     {
-        auto buffer = network.get_neighbours( idx_agent );
+        auto buffer = network.get_neighbours( network.agent_index( idx_original ) );
 
-        std::string row = fmt::format( "{} <- {{", idx_agent );
+        std::string row = fmt::format( "{} <- {{", idx_original );
         for( size_t i = 0; i < buffer.size() - 1; i++ )
         {
-            row += fmt::format( "{}, ", buffer[i] );
+            row += fmt::format( "{}, ", network.original_index( buffer[i] ) );
         }
-        row += fmt::format( "{}}}\n", buffer[buffer.size() - 1] );
+        row += fmt::format( "{}}}\n", network.original_index( buffer[buffer.size() - 1] ) );
 
         fs << row;
     }
@@ -35,61 +110,132 @@ void network_to_dot_file( const Network<AgentT> & network, const std::string & f
     fs.close();
 }
 
-template<typename AgentT>
-void network_to_file( const Network<AgentT> & network, const std::string & file_path )
+template<typename AgentT, typename WeightT, typename IndexT>
+void network_to_file( const Network<AgentT, WeightT, IndexT> & network, const std::string & file_path )
 {
-    std::fstream fs;
-    fs.open( file_path, std::fstream::in | std::fstream::out | std::fstream::trunc );
+    const size_t n_agents = network.n_agents();
 
-    size_t n_agents = network.n_agents();
-
-    fmt::print( fs, "# idx_agent, n_neighbours_in, indices_neighbours_in[...], weights_in[...]\n" );
-
-    for( size_t idx_agent = 0; idx_agent < n_agents; idx_agent++ )
+    // The rows are formatted straight into the buffer, without building a string per row or number
+    auto format_rows = [&]( fmt::memory_buffer & buffer, size_t idx_begin, size_t idx_end )
     {
-        auto buffer_neighbours = network.get_neighbours( idx_agent );
-        auto buffer_weights    = network.get_weights( idx_agent );
+        auto out = std::back_inserter( buffer );
+        for( size_t idx_original = idx_begin; idx_original < idx_end; idx_original++ )
+        {
+            const auto idx_agent   = network.agent_index( idx_original );
+            auto buffer_neighbours = network.get_neighbours( idx_agent );
+            auto buffer_weights    = network.get_weights( idx_agent );
 
-        std::string row = fmt::format( "{:>5}, {:>5}", idx_agent, buffer_neighbours.size() );
+            fmt::format_to( out, FMT_COMPILE( "{:>5}, {:>5}" ), idx_original, buffer_neighbours.size() );
 
-        if( buffer_neighbours.empty() )
-        {
-            row += "\n";
-        }
-        else
-        {
-            row += ", ";
-        }
+            if( buffer_neighbours.empty() )
+            {
+                fmt::format_to( out, FMT_COMPILE( "\n" ) );
+            }
+            else
+            {
+                fmt::format_to( out, FMT_COMPILE( ", " ) );
+            }
 
-        for( const auto & idx_neighbour : buffer_neighbours )
-        {
-            row += fmt::format( "{:>5}, ", idx_neighbour );
-        }
+            for( const auto & idx_neighbour : buffer_neighbours )
+            {
+                fmt::format_to( out, FMT_COMPILE( "{:>5}, " ), network.original_index( idx_neighbour ) );
+            }
 
-        const auto n_weights = buffer_weights.size();
-        for( size_t i_weight = 0; i_weight < n_weights; i_weight++ )
-        {
-            const auto & weight = buffer_weights[i_weight];
-            if( i_weight == n_weights - 1 ) // At the end of a row
+            const auto n_weights = buffer_weights.size();
+            for( size_t i_weight = 0; i_weight < n_weights; i_weight++ )
             {
-                if( idx_agent == n_agents - 1 ) // At the end of the file
+                const auto & weight = buffer_weights[i_weight];
+                if( i_weight == n_weights - 1 ) // At the end of a row
                 {
-                    row += fmt::format( "{:>25}", weight );
+                    if( idx_original == n_agents - 1 ) // At the end of the file
+                    {
+                        fmt::format_to( out, FMT_COMPILE( "{:>25}" ), weight );
+                    }
+                    else
+                    {
+                        fmt::format_to( out, FMT_COMPILE( "{:>25}\n" ), weight );
+                    }
                 }
                 else
                 {
-                    row += fmt::format( "{:>25}\n", weight );
+                    fmt::format_to( out, FMT_COMPILE( "{:>25}, " ), weight );
                 }
             }
-            else
-            {
-                row += fmt::format( "{:>25}, ", weight );
-            }
         }
+    };
 
-        fs << row;
+    write_rows_to_file(
+        file_path, "# idx_agent, n_neighbours_in, indices_neighbours_in[...], weights_in[...]\n", n_agents,
+        format_rows );
+}
+
+/*
+    Writes the network in the binary format (see BinaryNetworkHeader), which can be loaded much faster than the text
+    format (see NetworkGeneration::generate_from_file)
+*/
+template<typename AgentT, typename WeightT, typename IndexT>
+void network_to_binary_file( const Network<AgentT, WeightT, IndexT> & network, const std::string & file_path )
+{
+    using NetworkT    = Network<AgentT, WeightT, IndexT>;
+    using WeightValue = typename NetworkT::WeightT;
+    static_assert(
+        !NetworkT::is_weighted || std::is_floating_point_v<WeightValue>,
+        "The binary network format stores floating point weights" );
+
+    std::ofstream fs( file_path, std::ios::binary | std::ios::trunc );
+    if( !fs )
+    {
+        throw std::runtime_error( fmt::format( "Cannot write to {}.", file_path ) );
+    }
+
+    const size_t n_agents = network.n_agents();
+    BinaryNetworkHeader header{};
+    header.direction    = network.direction() == NetworkT::EdgeDirection::Incoming ? 0 : 1;
+    header.index_bytes  = sizeof( IndexT );
+    header.weight_bytes = NetworkT::is_weighted ? sizeof( WeightValue ) : 0;
+    header.n_agents     = n_agents;
+    header.n_edges      = network.n_edges();
+
+    auto write_span = [&]( const auto & span )
+    { fs.write( reinterpret_cast<const char *>( span.data() ), std::streamsize( span.size_bytes() ) ); };
+    fs.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+
+    // The rows are written in the original order of the agents, with the original indices
+    std::vector<std::uint64_t> offsets( n_agents + 1, 0 );
+    for( size_t idx_original = 0; idx_original < n_agents; idx_original++ )
+    {
+        offsets[idx_original + 1] = offsets[idx_original] + network.n_edges( network.agent_index( idx_original ) );
+    }
+    write_span( std::span( offsets ) );
+
+    std::vector<IndexT> buffer_neighbours{};
+    for( size_t idx_original = 0; idx_original < n_agents; idx_original++ )
+    {
+        const auto neighbours = network.get_neighbours( network.agent_index( idx_original ) );
+        buffer_neighbours.resize( neighbours.size() );
+        for( size_t i = 0; i < neighbours.size(); i++ )
+        {
+            buffer_neighbours[i] = IndexT( network.original_index( neighbours[i] ) );
+        }
+        write_span( std::span( buffer_neighbours ) );
+    }
+
+    const std::array<char, 8> padding{};
+    const size_t neighbours_end = header.neighbours_begin() + header.n_edges * header.index_bytes;
+    fs.write( padding.data(), std::streamsize( header.weights_begin() - neighbours_end ) );
+
+    if constexpr( NetworkT::is_weighted )
+    {
+        for( size_t idx_original = 0; idx_original < n_agents; idx_original++ )
+        {
+            write_span( network.get_weights( network.agent_index( idx_original ) ) );
+        }
+    }
+
+    if( !fs )
+    {
+        throw std::runtime_error( fmt::format( "Cannot write to {}.", file_path ) );
     }
-    fs.close();
 }
 
 } // namespace Seldon
\ No newline at end of file
@@ -0,0 +1,201 @@
+#pragma once
+#include "network.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <span>
+#include <vector>
+
+/*
+    Orderings of the agents, which can be passed to Network::permute_agents. Agents that are connected end up close
+    to each other, so that the neighbours of an agent are found close together in memory.
+    All orderings treat the network as undirected, so they do not depend on the direction of the stored edges.
+    Every function returns new_order, where new_order[i] is the (current) index of the agent that becomes agent i.
+*/
+namespace Seldon::NetworkReordering
+{
+
+/*
+    The edges of a network in both directions, in CSR format. The neighbours of agent i are in
+    [offsets[i], offsets[i+1]), first the stored edges and then the edges of the other direction
+*/
+template<typename IndexT>
+struct UndirectedAdjacency
+{
+    std::vector<size_t> offsets{};
+    std::vector<IndexT> neighbours{};
+
+    [[nodiscard]] std::span<const IndexT> get_neighbours( size_t agent_idx ) const
+    {
+        return std::span<const IndexT>(
+            neighbours.data() + offsets[agent_idx], offsets[agent_idx + 1] - offsets[agent_idx] );
+    }
+
+    [[nodiscard]] size_t degree( size_t agent_idx ) const
+    {
+        return offsets[agent_idx + 1] - offsets[agent_idx];
+    }
+};
+
+template<typename AgentT, typename WeightT, typename IndexT>
+UndirectedAdjacency<IndexT> undirected_adjacency( const Network<AgentT, WeightT, IndexT> & network )
+{
+    const size_t n_agents = network.n_agents();
+    UndirectedAdjacency<IndexT> adjacency{};
+
+    // Count the edges of every agent in both directions
+    std::vector<size_t> degree( n_agents, 0 );
+    for( size_t idx_agent = 0; idx_agent < n_agents; idx_agent++ )
+    {
+        auto neighbours = network.get_neighbours( idx_agent );
+        degree[idx_agent] += neighbours.size();
+        for( const auto & neighbour : neighbours )
+        {
+            degree[neighbour]++;
+        }
+    }
+
+    adjacency.offsets.resize( n_agents + 1 );
+    adjacency.offsets[0] = 0;
+    std::inclusive_scan( degree.begin(), degree.end(), adjacency.offsets.begin() + 1 );
+    adjacency.neighbours.resize( adjacency.offsets.back() );
+
+    // The stored edges go first, so that the insertion position starts after them
+    std::vector<size_t> position( adjacency.offsets.begin(), adjacency.offsets.end() - 1 );
+    for( size_t idx_agent = 0; idx_agent < n_agents; idx_agent++ )
+    {
+        auto neighbours = network.get_neighbours( idx_agent );
+        std::copy( neighbours.begin(), neighbours.end(), adjacency.neighbours.begin() + position[idx_agent] );
+        position[idx_agent] += neighbours.size();
+    }
+    for( size_t idx_agent = 0; idx_agent < n_agents; idx_agent++ )
+    {
+        for( const auto & neighbour : network.get_neighbours( idx_agent ) )
+        {
+            adjacency.neighbours[position[neighbour]++] = IndexT( idx_agent );
+        }
+    }
+
+    return adjacency;
+}
+
+/*
+    Breadth-first search, starting from the agent with the lowest index in every connected component.
+    The neighbours are visited in the order in which they are stored
+*/
+template<typename AgentT, typename WeightT, typename IndexT>
+std::vector<size_t> breadth_first_order( const Network<AgentT, WeightT, IndexT> & network )
+{
+    const size_t n_agents = network.n_agents();
+    const auto adjacency  = undirected_adjacency( network );
+
+    std::vector<size_t> new_order{};
+    new_order.reserve( n_agents );
+    std::vector<bool> visited( n_agents, false );
+
+    for( size_t idx_start = 0; idx_start < n_agents; idx_start++ )
+    {
+        if( visited[idx_start] )
+        {
+            continue;
+        }
+
+        // new_order doubles as the queue of the breadth-first search
+        visited[idx_start] = true;
+        new_order.push_back( idx_start );
+        for( size_t idx_queue = new_order.size() - 1; idx_queue < new_order.size(); idx_queue++ )
+        {
+            for( const auto & neighbour : adjacency.get_neighbours( new_order[idx_queue] ) )
+            {
+                if( !visited[neighbour] )
+                {
+                    visited[neighbour] = true;
+                    new_order.push_back( neighbour );
+                }
+            }
+        }
+    }
+
+    return new_order;
+}
+
+/*
+    Reverse Cuthill-McKee ordering, which reduces the bandwidth of the adjacency matrix.
+    Every connected component is searched breadth-first, starting from its agent with the lowest degree, and the
+    neighbours are visited by increasing degree. The resulting order is reversed at the end
+*/
+template<typename AgentT, typename WeightT, typename IndexT>
+std::vector<size_t> reverse_cuthill_mckee( const Network<AgentT, WeightT, IndexT> & network )
+{
+    const size_t n_agents = network.n_agents();
+    const auto adjacency  = undirected_adjacency( network );
+
+    auto by_degree = [&]( size_t i1, size_t i2 ) { return adjacency.degree( i1 ) < adjacency.degree( i2 ); };
+
+    // The candidates for the start of every component, by increasing degree
+    std::vector<size_t> start_candidates( n_agents );
+    std::iota( start_candidates.begin(), start_candidates.end(), 0 );
+    std::stable_sort( start_candidates.begin(), start_candidates.end(), by_degree );
+
+    std::vector<size_t> new_order{};
+    new_order.reserve( n_agents );
+    std::vector<bool> visited( n_agents, false );
+    std::vector<size_t> unvisited_neighbours{};
+
+    for( const auto & idx_start : start_candidates )
+    {
+        if( visited[idx_start] )
+        {
+            continue;
+        }
+
+        visited[idx_start] = true;
+        new_order.push_back( idx_start );
+        for( size_t idx_queue = new_order.size() - 1; idx_queue < new_order.size(); idx_queue++ )
+        {
+            unvisited_neighbours.clear();
+            for( const auto & neighbour : adjacency.get_neighbours( new_order[idx_queue] ) )
+            {
+                if( !visited[neighbour] )
+                {
+                    visited[neighbour] = true;
+                    unvisited_neighbours.push_back( neighbour );
+                }
+            }
+            std::stable_sort( unvisited_neighbours.begin(), unvisited_neighbours.end(), by_degree );
+            new_order.insert( new_order.end(), unvisited_neighbours.begin(), unvisited_neighbours.end() );
+        }
+    }
+
+    std::reverse( new_order.begin(), new_order.end() );
+    return new_order;
+}
+
+/*
+    Sorts the agents by decreasing degree (incoming plus outgoing edges), so that the most connected agents, which
+    are accessed most often, share the same part of memory. Agents with the same degree keep their relative order
+*/
+template<typename AgentT, typename WeightT, typename IndexT>
+std::vector<size_t> degree_order( const Network<AgentT, WeightT, IndexT> & network )
+{
+    const size_t n_agents = network.n_agents();
+
+    std::vector<size_t> degree( n_agents, 0 );
+    for( size_t idx_agent = 0; idx_agent < n_agents; idx_agent++ )
+    {
+        auto neighbours = network.get_neighbours( idx_agent );
+        degree[idx_agent] += neighbours.size();
+        for( const auto & neighbour : neighbours )
+        {
+            degree[neighbour]++;
+        }
+    }
+
+    std::vector<size_t> new_order( n_agents );
+    std::iota( new_order.begin(), new_order.end(), 0 );
+    std::stable_sort(
+        new_order.begin(), new_order.end(), [&]( size_t i1, size_t i2 ) { return degree[i1] > degree[i2]; } );
+    return new_order;
+}
+
+} // namespace Seldon::NetworkReordering
\ No newline at end of file
@@ -4,15 +4,19 @@
 #include "fmt/core.h"
 #include "model_factory.hpp"
 #include "network.hpp"
+#include "util/parallel.hpp"
 #include <fmt/chrono.h>
 #include <fmt/format.h>
+#include <fmt/ostream.h>
 #include <filesystem>
+#include <fstream>
 #include <memory>
 #include <models/ActivityDrivenModel.hpp>
 #include <models/DeGroot.hpp>
 #include <models/DeffuantModel.hpp>
 #include <network_generation.hpp>
 #include <network_io.hpp>
+#include <network_reordering.hpp>
 #include <optional>
 #include <string>
 namespace fs = std::filesystem;
@@ -27,7 +31,11 @@ public:
     virtual ~SimulationInterface()                       = default;
 };
 
-template<typename AgentType>
+/*
+    WeightType is Unweighted for models that do not use the edge weights (e.g. the Deffuant model), so that the network
+    stores no weights at all
+*/
+template<typename AgentType, typename WeightType = double>
 class Simulation : public SimulationInterface
 {
 
@@ -35,8 +43,10 @@ private:
     std::mt19937 gen;
 
 public:
+    using NetworkT = Network<AgentType, WeightType>;
+
     std::unique_ptr<Model<AgentType>> model;
-    Network<AgentType> network;
+    NetworkT network;
 
     Config::OutputSettings output_settings;
 
@@ -50,13 +60,34 @@ public:
 
         if( file.has_value() )
         {
-            network = NetworkGeneration::generate_from_file<AgentType>( file.value() );
+            network = NetworkGeneration::generate_from_file<AgentType, WeightType>( file.value() );
         }
         else
         {
             int n_agents       = options.network_settings.n_agents;
             auto n_connections = options.network_settings.n_connections;
-            network = NetworkGeneration::generate_n_connections<AgentType>( n_agents, n_connections, true, gen );
+            if( options.network_settings.type == "barabasi_albert" )
+            {
+                network = NetworkGeneration::generate_barabasi_albert<AgentType, WeightType>(
+                    n_agents, n_connections, true, gen );
+            }
+            else if( options.network_settings.type == "stochastic_block_model" )
+            {
+                network = NetworkGeneration::generate_stochastic_block_model<AgentType, WeightType>(
+                    options.network_settings.block_sizes, options.network_settings.block_probabilities, true,
+                    RNGStreams( gen() ) );
+            }
+            else if( options.network_settings.parallel_generation )
+            {
+                // Every agent draws its connections from its own stream, so the network does not depend on n_threads
+                network = NetworkGeneration::generate_n_connections<AgentType, WeightType>(
+                    n_agents, n_connections, true, RNGStreams( gen() ) );
+            }
+            else
+            {
+                network = NetworkGeneration::generate_n_connections<AgentType, WeightType>(
+                    n_agents, n_connections, true, gen );
+            }
         }
     }
 
@@ -100,9 +131,37 @@ public:
     {
         // Initialize the rng
         gen = std::mt19937( options.rng_seed );
+        Parallel::set_n_threads( options.n_threads );
 
         create_network( options, cli_network_file );
         create_model( options, cli_agent_file );
+
+        // Relabel the agents, so that connected agents are close in memory. The output uses the original indices.
+        // A complete graph has nothing to gain from this
+        if( network.storage() != NetworkT::StorageType::FullyConnected )
+        {
+            const auto & ordering = options.network_settings.ordering;
+            if( ordering == "bfs" )
+            {
+                network.permute_agents( NetworkReordering::breadth_first_order( network ) );
+            }
+            else if( ordering == "rcm" )
+            {
+                network.permute_agents( NetworkReordering::reverse_cuthill_mckee( network ) );
+            }
+            else if( ordering == "degree" )
+            {
+                network.permute_agents( NetworkReordering::degree_order( network ) );
+            }
+        }
+
+        // The model might have replaced the network, so we convert the storage format only now.
+        // Implicitly stored complete graphs are already more compact than CSR, so they are left alone
+        if( options.network_settings.use_csr
+            && network.storage() == NetworkT::StorageType::AdjacencyList )
+        {
+            network.set_storage( NetworkT::StorageType::CSR );
+        }
     }
 
     void run( const fs::path & output_dir_path ) override
@@ -116,17 +175,24 @@ public:
         fmt::print( "-----------------------------------------------------------------\n" );
         fmt::print( "Starting simulation\n" );
         fmt::print( "-----------------------------------------------------------------\n" );
+        print_memory_usage();
 
         if( output_initial )
         {
-            Seldon::network_to_file(
-                network,
-                ( output_dir_path / fs::path( fmt::format( "network_{}.txt", initial_step_number ) ) ).string() );
+            write_network( output_dir_path, initial_step_number );
             auto filename = fmt::format( "opinions_{}.txt", initial_step_number );
             Seldon::agents_to_file( network, ( output_dir_path / fs::path( filename ) ).string() );
         }
         this->model->initialize_iterations();
 
+        // One line per iteration, for models that track the connectivity of their network
+        std::ofstream connectivity_file{};
+        if( this->output_settings.output_connectivity )
+        {
+            connectivity_file.open( output_dir_path / fs::path( "connectivity.txt" ) );
+            fmt::print( connectivity_file, "# iteration, n_components, giant_component_size, n_isolated\n" );
+        }
+
         typedef std::chrono::milliseconds ms;
         auto t_simulation_start = std::chrono::high_resolution_clock::now();
         while( !this->model->finished() )
@@ -146,6 +212,15 @@ public:
                     std::chrono::floor<ms>( iter_time ) );
             }
 
+            // Write out the connectivity?
+            auto connectivity = this->model->connectivity_stats();
+            if( connectivity_file.is_open() && connectivity.has_value() )
+            {
+                fmt::print(
+                    connectivity_file, "{}, {}, {}, {}\n", this->model->n_iterations() + initial_step_number,
+                    connectivity->n_components, connectivity->giant_component_size, connectivity->n_isolated );
+            }
+
             // Write out the opinion?
             if( n_output_agents.has_value() && ( this->model->n_iterations() >= start_output )
                 && ( this->model->n_iterations() % n_output_agents.value() == 0 ) )
@@ -158,8 +233,7 @@ public:
             if( n_output_network.has_value() && ( this->model->n_iterations() >= start_output )
                 && ( this->model->n_iterations() % n_output_network.value() == 0 ) )
             {
-                auto filename = fmt::format( "network_{}.txt", this->model->n_iterations() + initial_step_number );
-                Seldon::network_to_file( network, ( output_dir_path / fs::path( filename ) ).string() );
+                write_network( output_dir_path, this->model->n_iterations() + initial_step_number );
             }
         }
 
@@ -170,8 +244,37 @@ public:
         fmt::print(
             "Finished after {} iterations, total time = {:%Hh %Mm %Ss}\n", this->model->n_iterations(),
             std::chrono::floor<ms>( total_time ) );
+        print_memory_usage();
         fmt::print( "=================================================================\n" );
     }
+
+    /*
+    Writes the network of the given step to network_<step>.txt, or to network_<step>.bin in the binary format, which
+    can be read back with the -n option, if binary_network is set
+    */
+    void write_network( const fs::path & output_dir_path, size_t step ) const
+    {
+        if( this->output_settings.binary_network )
+        {
+            auto filename = fmt::format( "network_{}.bin", step );
+            Seldon::network_to_binary_file( network, ( output_dir_path / fs::path( filename ) ).string() );
+        }
+        else
+        {
+            auto filename = fmt::format( "network_{}.txt", step );
+            Seldon::network_to_file( network, ( output_dir_path / fs::path( filename ) ).string() );
+        }
+    }
+
+    /*
+    Prints the memory used by the network and the model, per data structure
+    */
+    void print_memory_usage() const
+    {
+        auto usage = network.memory_usage();
+        usage.add( "model", model->memory_usage() );
+        fmt::print( "Memory usage\n{}", usage.to_string() );
+    }
 }; // namespace Seldon
 
 } // namespace Seldon
\ No newline at end of file
@@ -2,7 +2,10 @@
 #include "fmt/core.h"
 #include "util/erfinv.hpp"
 #include <algorithm>
+#include <bit>
+#include <cmath>
 #include <cstddef>
+#include <limits>
 #include <optional>
 #include <queue>
 #include <random>
@@ -14,56 +17,154 @@
 namespace Seldon
 {
 
-// Function for getting a vector of k agents (corresponding to connections)
-// drawing from n agents (without duplication)
-// ignore_idx ignores the index of the agent itself, since we will later add the agent itself ourselves to prevent duplication
-inline void draw_unique_k_from_n(
-    std::optional<size_t> ignore_idx, std::size_t k, std::size_t n, std::vector<std::size_t> & buffer,
-    std::mt19937 & gen )
+// Fills the buffer with buffer.size() unique agents drawn from n agents, e.g. directly into the storage of a network
+// ignore_idx ignores the index of the agent itself. There have to be at least buffer.size() agents to choose from
+// The buffer is sorted.
+// For k << n, Floyd's algorithm draws the indices in O(k log k), otherwise selection sampling goes through all n
+template<typename IndexT, typename GeneratorT>
+void draw_unique_from_n_into(
+    std::optional<size_t> ignore_idx, std::size_t n, std::span<IndexT> buffer, GeneratorT & gen )
 {
-    struct SequenceGenerator
+    // The indices are drawn from [0, n_candidates) and then shifted past ignore_idx
+    const bool ignore         = ignore_idx.has_value() && ignore_idx.value() < n;
+    const size_t n_candidates = ignore ? n - 1 : n;
+    auto to_index             = [&]( size_t j ) { return IndexT( ( ignore && j >= ignore_idx.value() ) ? j + 1 : j ); };
+
+    const size_t k = buffer.size();
+    if( k > n_candidates )
+    {
+        throw std::runtime_error( "draw_unique_from_n_into: there are not enough agents to draw from!" );
+    }
+
+    // Selection sampling (Knuth's algorithm S) does not need to remember the drawn indices, so it is faster unless
+    // only a small fraction of the candidates is drawn
+    constexpr size_t floyd_ratio = 16;
+    if( k * floyd_ratio > n_candidates )
     {
-        /* An iterator that generates a sequence of integers 2, 3, 4 ...*/
-        using iterator_category = std::forward_iterator_tag;
-        using difference_type   = std::ptrdiff_t;
-        using value_type        = size_t;
-        using pointer           = size_t *; // or also value_type*
-        using reference         = size_t &;
-
-        SequenceGenerator( const size_t i_, std::optional<size_t> ignore_idx ) : i( i_ ), ignore_idx( ignore_idx )
+        size_t n_selected = 0;
+        for( size_t j = 0; n_selected < k; j++ )
         {
-            if( ignore_idx.has_value() && i == ignore_idx.value() )
+            // Select j with probability (still to select) / (candidates left)
+            std::uniform_int_distribution<size_t> dist( 0, n_candidates - j - 1 );
+            if( dist( gen ) < k - n_selected )
             {
-                i++;
+                buffer[n_selected++] = to_index( j );
             }
         }
-        size_t i;
-        std::optional<size_t> ignore_idx;
+        return;
+    }
+
+    // Floyd's algorithm: for every j in [n_candidates - k, n_candidates), draw t from [0, j] and take t, or j if t
+    // has been taken already. For small k, the drawn indices are searched directly, otherwise in a hash set
+    constexpr size_t max_linear_search = 64;
+    constexpr size_t empty_slot        = std::numeric_limits<size_t>::max();
+    const size_t table_size            = k > max_linear_search ? std::bit_ceil( 2 * k ) : 0;
+    std::vector<size_t> table( table_size, empty_slot );
 
-        size_t & operator*()
+    auto contains = [&]( size_t j, size_t n_drawn )
+    {
+        if( table_size == 0 )
         {
-            return i;
-        };
-        bool operator==( const SequenceGenerator & it1 ) const
+            return std::find( buffer.begin(), buffer.begin() + n_drawn, IndexT( j ) ) != buffer.begin() + n_drawn;
+        }
+        // Fibonacci hashing with linear probing
+        size_t slot = ( j * 11400714819323198485ull ) & ( table_size - 1 );
+        while( table[slot] != empty_slot )
         {
-            return i == it1.i;
-        };
-        SequenceGenerator & operator++()
+            if( table[slot] == j )
+            {
+                return true;
+            }
+            slot = ( slot + 1 ) & ( table_size - 1 );
+        }
+        return false;
+    };
+
+    auto add = [&]( size_t j )
+    {
+        if( table_size == 0 )
+        {
+            return;
+        }
+        size_t slot = ( j * 11400714819323198485ull ) & ( table_size - 1 );
+        while( table[slot] != empty_slot )
         {
-            i++;
-            if( ignore_idx.has_value() && i == ignore_idx )
-                i++;
-            return *this;
+            slot = ( slot + 1 ) & ( table_size - 1 );
         }
+        table[slot] = j;
     };
 
-    buffer.resize( k );
-    std::sample( SequenceGenerator( 0, ignore_idx ), SequenceGenerator( n, ignore_idx ), buffer.begin(), k, gen );
+    for( size_t i = 0; i < k; i++ )
+    {
+        const size_t j = n_candidates - k + i;
+        std::uniform_int_distribution<size_t> dist( 0, j );
+        size_t t = dist( gen );
+        if( contains( t, i ) )
+        {
+            t = j; // j is larger than all indices drawn so far
+        }
+        buffer[i] = IndexT( t );
+        add( t );
+    }
+
+    std::sort( buffer.begin(), buffer.end() );
+    std::transform( buffer.begin(), buffer.end(), buffer.begin(), to_index );
+}
+
+// Function for getting a vector of k agents (corresponding to connections)
+// drawing from n agents (without duplication)
+// ignore_idx ignores the index of the agent itself, since we will later add the agent itself ourselves to prevent duplication
+// IndexT is the integer type of the indices in the buffer, GeneratorT any random number engine
+// The buffer is sorted. If there are fewer than k agents to choose from, all of them are drawn.
+template<typename IndexT = size_t, typename GeneratorT = std::mt19937>
+void draw_unique_k_from_n(
+    std::optional<size_t> ignore_idx, std::size_t k, std::size_t n, std::vector<IndexT> & buffer, GeneratorT & gen )
+{
+    const bool ignore         = ignore_idx.has_value() && ignore_idx.value() < n;
+    const size_t n_candidates = ignore ? n - 1 : n;
+    buffer.resize( std::min( k, n_candidates ) );
+    draw_unique_from_n_into( ignore_idx, n, std::span<IndexT>( buffer ), gen );
+}
+
+// Calls func( j ) for every j in [0, n) that is selected independently with probability p, in increasing order of j
+// Geometric skipping (Batagelj & Brandes) draws the gaps between the selected indices directly, so this costs
+// O(1 + n p) instead of O(n)
+template<typename FuncT, typename GeneratorT>
+void for_each_bernoulli_selected( std::size_t n, double p, GeneratorT & gen, FuncT && func )
+{
+    if( n == 0 || p <= 0.0 )
+    {
+        return;
+    }
+    if( p >= 1.0 )
+    {
+        for( size_t j = 0; j < n; j++ )
+        {
+            func( j );
+        }
+        return;
+    }
+
+    std::uniform_real_distribution<double> distribution( 0.0, 1.0 );
+    const double log_q = std::log1p( -p );
+    size_t j           = 0; // The next candidate
+    while( true )
+    {
+        // The number of candidates that are not selected before the next selected one
+        const double skip = std::floor( std::log( 1.0 - distribution( gen ) ) / log_q );
+        if( skip >= double( n - j ) )
+        {
+            return;
+        }
+        j += size_t( skip );
+        func( j );
+        j++;
+    }
 }
 
-template<typename WeightCallbackT>
+template<typename WeightCallbackT, typename IndexT = size_t>
 void reservoir_sampling_A_ExpJ(
-    size_t k, size_t n, WeightCallbackT weight, std::vector<std::size_t> & buffer, std::mt19937 & mt )
+    size_t k, size_t n, WeightCallbackT weight, std::vector<IndexT> & buffer, std::mt19937 & mt )
 {
     if( k == 0 )
         return;
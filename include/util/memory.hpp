@@ -0,0 +1,145 @@
+#pragma once
+#include <fmt/format.h>
+#include <array>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Seldon
+{
+
+/*
+    The memory an object owns on the heap, which is not included in its sizeof, as (bytes used, bytes allocated).
+    Specialise this for types that own memory, e.g. agents with a vector of opinions
+*/
+template<typename T>
+[[nodiscard]] std::pair<size_t, size_t> owned_memory( const T & object [[maybe_unused]] )
+{
+    return { 0, 0 };
+}
+
+/*
+    A breakdown of the memory used by the data structures of an object (e.g. a network or a model).
+    Every entry holds the bytes in use (the size of a vector) and the bytes allocated (its capacity).
+*/
+struct MemoryUsage
+{
+    struct Entry
+    {
+        std::string name{};
+        size_t bytes_used      = 0;
+        size_t bytes_allocated = 0;
+    };
+
+    std::vector<Entry> entries{};
+
+    /*
+    Adds a vector, including the memory owned by its elements. Vectors that never allocated are skipped
+    */
+    template<typename T>
+    void add( const std::string & name, const std::vector<T> & vec )
+    {
+        if( vec.capacity() == 0 )
+        {
+            return;
+        }
+
+        Entry entry{ name, vec.size() * sizeof( T ), vec.capacity() * sizeof( T ) };
+        // Types that own heap memory can not be trivially destructible
+        if constexpr( !std::is_trivially_destructible_v<T> )
+        {
+            for( const auto & element : vec )
+            {
+                const auto [used, allocated] = owned_memory( element );
+                entry.bytes_used += used;
+                entry.bytes_allocated += allocated;
+            }
+        }
+        entries.push_back( entry );
+    }
+
+    /*
+    Adds a vector of vectors (e.g. adjacency lists) as a single entry
+    */
+    template<typename T>
+    void add( const std::string & name, const std::vector<std::vector<T>> & vec )
+    {
+        if( vec.capacity() == 0 )
+        {
+            return;
+        }
+
+        Entry entry{ name, vec.size() * sizeof( std::vector<T> ), vec.capacity() * sizeof( std::vector<T> ) };
+        for( const auto & inner : vec )
+        {
+            entry.bytes_used += inner.size() * sizeof( T );
+            entry.bytes_allocated += inner.capacity() * sizeof( T );
+        }
+        entries.push_back( entry );
+    }
+
+    /*
+    Adds all entries of another breakdown, with their names prefixed by prefix
+    */
+    void add( const std::string & prefix, const MemoryUsage & other )
+    {
+        for( const auto & entry : other.entries )
+        {
+            entries.push_back( { prefix + "." + entry.name, entry.bytes_used, entry.bytes_allocated } );
+        }
+    }
+
+    [[nodiscard]] size_t total_used() const
+    {
+        size_t total = 0;
+        for( const auto & entry : entries )
+        {
+            total += entry.bytes_used;
+        }
+        return total;
+    }
+
+    [[nodiscard]] size_t total_allocated() const
+    {
+        size_t total = 0;
+        for( const auto & entry : entries )
+        {
+            total += entry.bytes_allocated;
+        }
+        return total;
+    }
+
+    /*
+    Gives a table with one line per entry and the total, in human readable units
+    */
+    [[nodiscard]] std::string to_string() const
+    {
+        auto format_bytes = []( size_t bytes )
+        {
+            constexpr std::array units = { "B", "KiB", "MiB", "GiB", "TiB" };
+            double value               = double( bytes );
+            size_t idx_unit            = 0;
+            while( value >= 1024.0 && idx_unit < units.size() - 1 )
+            {
+                value /= 1024.0;
+                idx_unit++;
+            }
+            return fmt::format( "{:>8.2f} {:<3}", value, units[idx_unit] );
+        };
+
+        std::string result = fmt::format( "    {:<40} {:>12}   {:>12}\n", "", "used", "allocated" );
+        for( const auto & entry : entries )
+        {
+            result += fmt::format(
+                "    {:<40} {} / {}\n", entry.name, format_bytes( entry.bytes_used ),
+                format_bytes( entry.bytes_allocated ) );
+        }
+        result += fmt::format(
+            "    {:<40} {} / {}\n", "total", format_bytes( total_used() ), format_bytes( total_allocated() ) );
+        return result;
+    }
+};
+
+} // namespace Seldon
\ No newline at end of file
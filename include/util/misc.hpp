@@ -1,10 +1,22 @@
 #pragma once
 #include "fmt/format.h"
+#include "util/parallel.hpp"
+#include <fcntl.h>
 #include <fmt/ostream.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace Seldon
 {
@@ -31,6 +43,63 @@ inline std::string get_file_contents( const std::string & filename )
     throw( std::runtime_error( "Cannot read file." ) );
 }
 
+/*
+A read-only memory mapping of a whole file, which is unmapped on destruction.
+The pages are only read from disk when they are accessed, so opening even a huge file is instant
+*/
+class MappedFile
+{
+public:
+    explicit MappedFile( const std::string & filename )
+    {
+        const int fd = ::open( filename.c_str(), O_RDONLY );
+        if( fd < 0 )
+        {
+            throw std::runtime_error( fmt::format( "Cannot read from {}. File does not exist!", filename ) );
+        }
+
+        struct stat file_stat; // Filled by fstat
+        if( ::fstat( fd, &file_stat ) != 0 )
+        {
+            ::close( fd );
+            throw std::runtime_error( fmt::format( "Cannot read from {}.", filename ) );
+        }
+
+        n_bytes = size_t( file_stat.st_size );
+        if( n_bytes > 0 )
+        {
+            void * ptr = ::mmap( nullptr, n_bytes, PROT_READ, MAP_PRIVATE, fd, 0 );
+            if( ptr == MAP_FAILED )
+            {
+                ::close( fd );
+                throw std::runtime_error( fmt::format( "Cannot map {} into memory.", filename ) );
+            }
+            data = static_cast<const char *>( ptr );
+        }
+        ::close( fd ); // The mapping stays valid
+    }
+
+    MappedFile( const MappedFile & )             = delete;
+    MappedFile & operator=( const MappedFile & ) = delete;
+
+    ~MappedFile()
+    {
+        if( data != nullptr )
+        {
+            ::munmap( const_cast<char *>( data ), n_bytes );
+        }
+    }
+
+    [[nodiscard]] std::span<const char> contents() const
+    {
+        return { data, n_bytes };
+    }
+
+private:
+    const char * data = nullptr;
+    size_t n_bytes    = 0;
+};
+
 /*
 Executes `callback` for each substring in a comma separated list.
 If the input is "a_d, b, 1", it would call the callback function like
@@ -59,4 +128,195 @@ void parse_comma_separated_list( const std::string & str, CallbackT & callback )
     }
 }
 
+/*
+Parses the number at the start of str, like std::stod and std::stoi: leading whitespace and a leading '+' are
+skipped and everything after the number (e.g. whitespace in front of a comma) is ignored.
+Uses std::from_chars, so nothing is allocated. Throws if str does not start with a number
+*/
+template<typename T>
+[[nodiscard]] T parse_number( std::string_view str )
+{
+    const char * begin = str.data();
+    const char * end   = str.data() + str.size();
+    while( begin != end && std::isspace( static_cast<unsigned char>( *begin ) ) )
+    {
+        begin++;
+    }
+    if( begin != end && *begin == '+' )
+    {
+        begin++;
+    }
+
+    T value{};
+    const auto result = std::from_chars( begin, end, value );
+    if( result.ec != std::errc() )
+    {
+        throw std::runtime_error( fmt::format( "Cannot parse '{}' as a number.", str ) );
+    }
+    return value;
+}
+
+/*
+Executes `callback( idx_column, column )` for each column of a comma separated line. The columns are views into
+line, including their surrounding whitespace.
+*/
+template<typename CallbackT>
+void for_each_column( std::string_view line, CallbackT && callback )
+{
+    size_t idx_column = 0;
+    while( true )
+    {
+        const auto end_of_column = line.find( ',' );
+        callback( idx_column, line.substr( 0, end_of_column ) );
+        if( end_of_column == std::string_view::npos )
+        {
+            break;
+        }
+        line.remove_prefix( end_of_column + 1 );
+        idx_column++;
+    }
+}
+
+/*
+Executes `callback( line )` for each line of text, without the '\n', skipping comments (lines starting with '#').
+An empty line ends the data: returns false if text contains one, and true if all of text was read
+*/
+template<typename CallbackT>
+bool for_each_data_line( std::string_view text, CallbackT && callback )
+{
+    while( !text.empty() )
+    {
+        const auto end_of_line = text.find( '\n' );
+        const auto line        = text.substr( 0, end_of_line );
+        if( line.empty() )
+        {
+            return false;
+        }
+        if( line[0] != '#' )
+        {
+            callback( line );
+        }
+        if( end_of_line == std::string_view::npos )
+        {
+            break;
+        }
+        text.remove_prefix( end_of_line + 1 );
+    }
+    return true;
+}
+
+/*
+Splits text into at most n_chunks consecutive pieces of about the same size, which all begin at the start of a line.
+Used to parse a file in parallel, with one piece per thread
+*/
+inline std::vector<std::string_view> split_into_line_chunks( std::string_view text, size_t n_chunks )
+{
+    std::vector<std::string_view> chunks{};
+    size_t begin = 0;
+    for( size_t idx_chunk = 1; idx_chunk <= n_chunks && begin < text.size(); idx_chunk++ )
+    {
+        size_t end = text.size();
+        if( idx_chunk < n_chunks )
+        {
+            const auto end_of_line = text.find( '\n', std::max( begin, idx_chunk * text.size() / n_chunks ) );
+            end                    = ( end_of_line == std::string_view::npos ) ? text.size() : end_of_line + 1;
+        }
+        chunks.push_back( text.substr( begin, end - begin ) );
+        begin = end;
+    }
+    return chunks;
+}
+
+/*
+Parses the data lines of text (see for_each_data_line) in parallel. The text is split into line chunks of at least
+min_chunk_bytes, and every chunk gets its own ResultT, which is filled by calling parse_line( line, result ) for the
+lines in order. Gives the results of the chunks in order, up to the first empty line of text.
+Exceptions from the lines after the first empty line are ignored, just like a serial parser would never see them
+*/
+template<typename ResultT, typename ParseLineT>
+std::vector<ResultT> parse_lines_in_parallel(
+    std::string_view text, ParseLineT && parse_line, size_t min_chunk_bytes = size_t( 1 ) << 20 )
+{
+    const auto chunks = split_into_line_chunks( text, Parallel::n_chunks( text.size(), min_chunk_bytes ) );
+
+    std::vector<ResultT> results( chunks.size() );
+    std::vector<char> reached_end( chunks.size(), false ); // Not std::vector<bool>, the chunks write concurrently
+    std::vector<std::exception_ptr> exceptions( chunks.size() );
+    Parallel::for_each_index(
+        chunks.size(),
+        [&]( size_t idx_chunk )
+        {
+            try
+            {
+                reached_end[idx_chunk] = for_each_data_line(
+                    chunks[idx_chunk], [&]( std::string_view line ) { parse_line( line, results[idx_chunk] ); } );
+            }
+            catch( ... )
+            {
+                exceptions[idx_chunk] = std::current_exception();
+            }
+        },
+        1 );
+
+    size_t n_data_chunks = 0;
+    while( n_data_chunks < chunks.size() )
+    {
+        if( exceptions[n_data_chunks] )
+        {
+            std::rethrow_exception( exceptions[n_data_chunks] );
+        }
+        if( !reached_end[n_data_chunks++] )
+        {
+            break;
+        }
+    }
+    results.resize( n_data_chunks );
+    return results;
+}
+
+/*
+Writes header followed by the rows [0, n_rows) of a text file, where format_rows( buffer, idx_begin, idx_end ) appends
+the text of the rows [idx_begin, idx_end) to a fmt::memory_buffer.
+The rows are formatted in blocks of rows_per_chunk rows per thread, in parallel, into memory buffers that are reused
+for every block and written to the file in order. So the output does not depend on the number of threads
+*/
+template<typename FormatRowsT>
+void write_rows_to_file(
+    const std::string & file_path, std::string_view header, size_t n_rows, FormatRowsT && format_rows,
+    size_t rows_per_chunk = 4096 )
+{
+    std::ofstream fs( file_path, std::ios::out | std::ios::trunc | std::ios::binary );
+    if( !fs )
+    {
+        throw std::runtime_error( fmt::format( "Cannot write to {}.", file_path ) );
+    }
+    fs.write( header.data(), std::streamsize( header.size() ) );
+
+    const size_t n_threads  = Parallel::get_n_threads();
+    const size_t block_size = n_threads * rows_per_chunk;
+    std::vector<fmt::memory_buffer> buffers( n_threads );
+
+    for( size_t block_begin = 0; block_begin < n_rows; block_begin += block_size )
+    {
+        const size_t n_block_rows = std::min( block_size, n_rows - block_begin );
+        auto format_chunk         = [&]( size_t idx_begin, size_t idx_end, size_t idx_chunk )
+        {
+            buffers[idx_chunk].clear();
+            format_rows( buffers[idx_chunk], block_begin + idx_begin, block_begin + idx_end );
+        };
+        Parallel::for_each_chunk( n_block_rows, format_chunk, rows_per_chunk, n_threads );
+
+        const size_t n_chunks = Parallel::n_chunks( n_block_rows, rows_per_chunk, n_threads );
+        for( size_t idx_chunk = 0; idx_chunk < n_chunks; idx_chunk++ )
+        {
+            fs.write( buffers[idx_chunk].data(), std::streamsize( buffers[idx_chunk].size() ) );
+        }
+    }
+
+    if( !fs )
+    {
+        throw std::runtime_error( fmt::format( "Cannot write to {}.", file_path ) );
+    }
+}
+
 } // namespace Seldon
\ No newline at end of file
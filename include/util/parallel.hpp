@@ -0,0 +1,129 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace Seldon::Parallel
+{
+
+// Below this many items per chunk, spawning a thread costs more than it saves
+constexpr size_t default_min_chunk_size = 4096;
+
+// The number of threads requested by the user, 0 means std::thread::hardware_concurrency()
+inline size_t & n_threads_setting()
+{
+    static size_t n_threads = 0;
+    return n_threads;
+}
+
+/*
+Sets the number of threads used by the parallel algorithms. 0 means all hardware threads
+*/
+inline void set_n_threads( size_t n_threads )
+{
+    n_threads_setting() = n_threads;
+}
+
+/*
+Gives the number of threads used by the parallel algorithms (at least 1)
+*/
+inline size_t get_n_threads()
+{
+    if( n_threads_setting() > 0 )
+    {
+        return n_threads_setting();
+    }
+    return std::max<size_t>( 1, std::thread::hardware_concurrency() );
+}
+
+/*
+Gives the number of chunks that for_each_chunk splits the index range [0, n) into.
+Every chunk (except possibly the last) contains at least min_chunk_size indices.
+*/
+inline size_t n_chunks(
+    size_t n, size_t min_chunk_size = default_min_chunk_size, std::optional<size_t> n_threads = std::nullopt )
+{
+    const size_t max_chunks = std::max<size_t>( 1, n / std::max<size_t>( 1, min_chunk_size ) );
+    return std::clamp<size_t>( n_threads.value_or( get_n_threads() ), 1, max_chunks );
+}
+
+/*
+Splits the index range [0, n) into n_chunks contiguous chunks and calls func( idx_begin, idx_end, idx_chunk ) for
+each of them on its own thread. The first chunk runs on the calling thread.
+The chunk boundaries only depend on n, min_chunk_size and the number of threads.
+An exception thrown by any chunk is rethrown on the calling thread, after all threads have finished.
+*/
+template<typename FuncT>
+void for_each_chunk(
+    size_t n, FuncT && func, size_t min_chunk_size = default_min_chunk_size,
+    std::optional<size_t> n_threads = std::nullopt )
+{
+    const size_t n_chunk = n_chunks( n, min_chunk_size, n_threads );
+
+    if( n_chunk == 1 )
+    {
+        func( size_t( 0 ), n, size_t( 0 ) );
+        return;
+    }
+
+    auto chunk_begin = [&]( size_t idx_chunk ) { return idx_chunk * n / n_chunk; };
+
+    std::vector<std::exception_ptr> exceptions( n_chunk );
+    auto run_chunk = [&]( size_t idx_chunk )
+    {
+        try
+        {
+            func( chunk_begin( idx_chunk ), chunk_begin( idx_chunk + 1 ), idx_chunk );
+        }
+        catch( ... )
+        {
+            exceptions[idx_chunk] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads{};
+    threads.reserve( n_chunk - 1 );
+    for( size_t idx_chunk = 1; idx_chunk < n_chunk; idx_chunk++ )
+    {
+        threads.emplace_back( run_chunk, idx_chunk );
+    }
+    run_chunk( 0 );
+
+    for( auto & thread : threads )
+    {
+        thread.join();
+    }
+
+    for( const auto & exception : exceptions )
+    {
+        if( exception )
+        {
+            std::rethrow_exception( exception );
+        }
+    }
+}
+
+/*
+Calls func( idx ) for every idx in [0, n), distributed over the threads in contiguous chunks
+*/
+template<typename FuncT>
+void for_each_index(
+    size_t n, FuncT && func, size_t min_chunk_size = default_min_chunk_size,
+    std::optional<size_t> n_threads = std::nullopt )
+{
+    for_each_chunk(
+        n,
+        [&]( size_t idx_begin, size_t idx_end, size_t )
+        {
+            for( size_t idx = idx_begin; idx < idx_end; idx++ )
+            {
+                func( idx );
+            }
+        },
+        min_chunk_size, n_threads );
+}
+
+} // namespace Seldon::Parallel
\ No newline at end of file
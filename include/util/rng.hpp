@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace Seldon
+{
+
+/*
+    A small random number generator (SplitMix64), which satisfies the UniformRandomBitGenerator requirements, so it can
+    be used with the distributions of <random>. It is cheap to construct, unlike std::mt19937, so that one can be
+    created for every agent
+*/
+class StreamRNG
+{
+public:
+    using result_type = std::uint64_t;
+
+    explicit StreamRNG( std::uint64_t state ) : state( state ) {}
+
+    static constexpr result_type min()
+    {
+        return std::numeric_limits<result_type>::min();
+    }
+
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        state += golden_gamma;
+        return mix( state );
+    }
+
+    /*
+    The finalizer of SplitMix64, a bijection that scrambles all bits
+    */
+    static constexpr std::uint64_t mix( std::uint64_t z )
+    {
+        z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ull;
+        z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebull;
+        return z ^ ( z >> 31 );
+    }
+
+private:
+    static constexpr std::uint64_t golden_gamma = 0x9e3779b97f4a7c15ull;
+    std::uint64_t state;
+};
+
+/*
+    Independent random number streams, derived from a seed: stream( idx ) always starts the same sequence for the same
+    (seed, idx), no matter in which order (or on which thread) the streams are used. This makes parallel algorithms
+    reproducible, e.g. every agent draws from its own stream.
+    The starting points of the streams are scrambled, so that they are far apart in the 2^64 period of SplitMix64
+*/
+class RNGStreams
+{
+public:
+    explicit RNGStreams( std::uint64_t seed ) : seed( StreamRNG::mix( seed ) ) {}
+
+    [[nodiscard]] StreamRNG stream( size_t idx ) const
+    {
+        return StreamRNG( StreamRNG::mix( seed ^ StreamRNG::mix( std::uint64_t( idx ) + 1 ) ) );
+    }
+
+private:
+    std::uint64_t seed;
+};
+
+} // namespace Seldon
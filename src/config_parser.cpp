@@ -5,6 +5,7 @@
 #include <fmt/ostream.h>
 #include <fmt/ranges.h>
 #include <fmt/std.h>
+#include <algorithm>
 #include <cstddef>
 #include <optional>
 #include <stdexcept>
@@ -44,6 +45,28 @@ void set_if_specified( auto & opt, const auto & toml_opt )
         opt = t_opt.value();
 }
 
+// Reads a TOML array of numbers into values, if it is specified
+void set_array_if_specified( auto & values, const auto & toml_opt )
+{
+    using T                 = typename std::remove_reference_t<decltype( values )>::value_type;
+    const auto * toml_array = toml_opt.as_array();
+    if( toml_array == nullptr )
+    {
+        return;
+    }
+
+    values.clear();
+    for( const auto & elem : *toml_array )
+    {
+        auto value = elem.template value<T>();
+        if( !value.has_value() )
+        {
+            throw std::runtime_error( "The configuration file contains an array with an element of the wrong type!" );
+        }
+        values.push_back( value.value() );
+    }
+}
+
 // Convenience function to parse activity settings
 void parse_activity_settings( auto & model_settings, const auto & toml_model_opt, const auto & tbl )
 {
@@ -114,12 +137,15 @@ SimulationOptions parse_config_file( std::string_view config_file_path )
     tbl = toml::parse_file( config_file_path );
 
     options.rng_seed = tbl["simulation"]["rng_seed"].value_or( int( options.rng_seed ) );
+    set_if_specified( options.n_threads, tbl["simulation"]["n_threads"] );
 
     // Parse output settings
     options.output_settings.n_output_network = tbl["io"]["n_output_network"].value<size_t>();
     options.output_settings.n_output_agents  = tbl["io"]["n_output_agents"].value<size_t>();
     set_if_specified( options.output_settings.print_progress, tbl["io"]["print_progress"] );
     set_if_specified( options.output_settings.output_initial, tbl["io"]["output_initial"] );
+    set_if_specified( options.output_settings.output_connectivity, tbl["io"]["output_connectivity"] );
+    set_if_specified( options.output_settings.binary_network, tbl["io"]["binary_network"] );
     set_if_specified( options.output_settings.start_output, tbl["io"]["start_output"] );
     set_if_specified( options.output_settings.start_numbering_from, tbl["io"]["start_numbering_from"] );
 
@@ -145,6 +171,10 @@ SimulationOptions parse_config_file( std::string_view config_file_path )
         set_if_specified( model_settings.homophily_threshold, tbl[options.model_string]["homophily_threshold"] );
         set_if_specified( model_settings.mu, tbl[options.model_string]["mu"] );
         set_if_specified( model_settings.use_network, tbl[options.model_string]["use_network"] );
+        set_if_specified( model_settings.lattice_dim, tbl[options.model_string]["lattice_dim"] );
+        set_if_specified( model_settings.lattice_radius, tbl[options.model_string]["lattice_radius"] );
+        set_if_specified( model_settings.moore_neighbourhood, tbl[options.model_string]["moore_neighbourhood"] );
+        set_if_specified( model_settings.rewiring_probability, tbl[options.model_string]["rewiring_probability"] );
         // Options for the DeffuantModelVector model
         set_if_specified( model_settings.use_binary_vector, tbl[options.model_string]["binary_vector"] );
         set_if_specified( model_settings.dim, tbl[options.model_string]["dim"] );
@@ -168,8 +198,23 @@ SimulationOptions parse_config_file( std::string_view config_file_path )
 
     // Parse settings for the generation of the initial network
     options.network_settings = InitialNetworkSettings();
+    set_if_specified( options.network_settings.type, tbl["network"]["type"] );
     set_if_specified( options.network_settings.n_agents, tbl["network"]["number_of_agents"] );
     set_if_specified( options.network_settings.n_connections, tbl["network"]["connections_per_agent"] );
+    set_if_specified( options.network_settings.use_csr, tbl["network"]["csr"] );
+    set_if_specified( options.network_settings.parallel_generation, tbl["network"]["parallel_generation"] );
+    set_if_specified( options.network_settings.ordering, tbl["network"]["ordering"] );
+
+    // The probabilities of the stochastic block model are an array with one array per block
+    set_array_if_specified( options.network_settings.block_sizes, tbl["network"]["block_sizes"] );
+    if( const auto * toml_rows = tbl["network"]["block_probabilities"].as_array() )
+    {
+        for( const auto & toml_row : *toml_rows )
+        {
+            auto & row = options.network_settings.block_probabilities.emplace_back();
+            set_array_if_specified( row, toml_row );
+        }
+    }
 
     return options;
 }
@@ -203,6 +248,47 @@ void validate_settings( const SimulationOptions & options )
     check( name_and_var( options.output_settings.start_output ), g_zero );
     check( name_and_var( options.output_settings.start_numbering_from ), geq_zero );
 
+    check(
+        name_and_var( options.network_settings.ordering ),
+        []( const std::string & x ) { return x == "none" || x == "bfs" || x == "rcm" || x == "degree"; },
+        "Valid orderings are none, bfs, rcm and degree" );
+    check(
+        name_and_var( options.network_settings.type ),
+        []( const std::string & x )
+        { return x == "n_connections" || x == "barabasi_albert" || x == "stochastic_block_model"; },
+        "Valid network types are n_connections, barabasi_albert and stochastic_block_model" );
+    if( options.network_settings.type == "barabasi_albert" && !options.network_settings.file.has_value() )
+    {
+        check(
+            name_and_var( options.network_settings.n_agents ),
+            [&]( auto x ) { return x > options.network_settings.n_connections; },
+            "A Barabasi-Albert network needs more agents than connections_per_agent" );
+    }
+    if( options.network_settings.type == "stochastic_block_model" && !options.network_settings.file.has_value() )
+    {
+        const auto & block_sizes = options.network_settings.block_sizes;
+        check(
+            name_and_var( options.network_settings.block_sizes ), []( const auto & x ) { return !x.empty(); },
+            "A stochastic block model needs at least one block" );
+        check(
+            name_and_var( options.network_settings.block_probabilities ),
+            [&]( const auto & x )
+            {
+                return x.size() == block_sizes.size()
+                       && std::ranges::all_of(
+                           x,
+                           [&]( const auto & row )
+                           {
+                               return row.size() == block_sizes.size()
+                                      && std::ranges::all_of( row, []( double p ) { return p >= 0.0 && p <= 1.0; } );
+                           } );
+            },
+            "block_probabilities needs one row of probabilities in [0, 1] per block, with one entry per block" );
+    }
+    // Models that identify agents by their index can not be relabeled
+    const bool relabeled        = options.network_settings.ordering != "none";
+    const std::string fixed_msg = "The agents of this model can not be relabeled, use ordering = \"none\"";
+
     auto validate_activity = [&]( const auto & model_settings )
     {
         check( name_and_var( model_settings.dt ), g_zero );
@@ -232,12 +318,15 @@ void validate_settings( const SimulationOptions & options )
         auto model_settings = std::get<ActivityDrivenSettings>( options.model_settings );
 
         validate_activity( model_settings );
+        // The bots are the first n_bots agents
+        check( name_and_var( model_settings.n_bots ), [&]( auto x ) { return x == 0 || !relabeled; }, fixed_msg );
     }
     else if( options.model == Model::ActivityDrivenInertial )
     {
         auto model_settings = std::get<ActivityDrivenInertialSettings>( options.model_settings );
         check( name_and_var( model_settings.friction_coefficient ), geq_zero );
         validate_activity( model_settings );
+        check( name_and_var( model_settings.n_bots ), [&]( auto x ) { return x == 0 || !relabeled; }, fixed_msg );
     }
     else if( options.model == Model::DeGroot )
     {
@@ -251,6 +340,11 @@ void validate_settings( const SimulationOptions & options )
         check( name_and_var( model_settings.mu ), []( auto x ) { return x >= 0 && x <= 1; } );
         // DeffuantModelVector settings
         check( name_and_var( model_settings.dim ), g_zero );
+        // The square lattice neighbours are computed from the agent indices
+        check( name_and_var( model_settings.use_network ), [&]( auto x ) { return !x || !relabeled; }, fixed_msg );
+        check( name_and_var( model_settings.lattice_dim ), g_zero );
+        check( name_and_var( model_settings.lattice_radius ), g_zero );
+        check( name_and_var( model_settings.rewiring_probability ), []( auto x ) { return x >= 0 && x <= 1; } );
         // @TODO: maybe make this check nicer?
         if( !model_settings.use_binary_vector )
         {
@@ -264,6 +358,7 @@ void validate_settings( const SimulationOptions & options )
 void print_settings( const SimulationOptions & options )
 {
     fmt::print( "Random seed: {}\n", options.rng_seed );
+    fmt::print( "Number of threads: {}\n", options.n_threads );
 
     fmt::print( "[Model]\n" );
     fmt::print( "    type {}\n", options.model_string );
@@ -326,19 +421,31 @@ void print_settings( const SimulationOptions & options )
         fmt::print( "    homophily_threshold {}\n", model_settings.homophily_threshold );
         fmt::print( "    mu {}\n", model_settings.mu );
         fmt::print( "    use_network {}\n", model_settings.use_network );
+        fmt::print( "    lattice_dim {}\n", model_settings.lattice_dim );
+        fmt::print( "    lattice_radius {}\n", model_settings.lattice_radius );
+        fmt::print( "    moore_neighbourhood {}\n", model_settings.moore_neighbourhood );
+        fmt::print( "    rewiring_probability {}\n", model_settings.rewiring_probability );
         fmt::print( "    use_binary_vector {}\n", model_settings.use_binary_vector );
         fmt::print( "    dim {}\n", model_settings.dim );
     }
 
     fmt::print( "[Network]\n" );
+    fmt::print( "    type {}\n", options.network_settings.type );
     fmt::print( "    n_agents {}\n", options.network_settings.n_agents );
     fmt::print( "    n_connections {}\n", options.network_settings.n_connections );
+    fmt::print( "    use_csr {}\n", options.network_settings.use_csr );
+    fmt::print( "    parallel_generation {}\n", options.network_settings.parallel_generation );
+    fmt::print( "    block_sizes {}\n", options.network_settings.block_sizes );
+    fmt::print( "    block_probabilities {}\n", options.network_settings.block_probabilities );
+    fmt::print( "    ordering {}\n", options.network_settings.ordering );
 
     fmt::print( "[Output]\n" );
     fmt::print( "    n_output_agents  {}\n", options.output_settings.n_output_agents );
     fmt::print( "    n_output_network {}\n", options.output_settings.n_output_network );
     fmt::print( "    print_progress {}\n", options.output_settings.print_progress );
     fmt::print( "    output_initial {}\n", options.output_settings.output_initial );
+    fmt::print( "    output_connectivity {}\n", options.output_settings.output_connectivity );
+    fmt::print( "    binary_network {}\n", options.output_settings.binary_network );
     fmt::print( "    start_output {}\n", options.output_settings.start_output );
     fmt::print( "    start_numbering_from {}\n", options.output_settings.start_numbering_from );
 }
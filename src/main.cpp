@@ -21,7 +21,8 @@ int main( int argc, char * argv[] )
         .help( "Specify the output directory. Defaults to `path/to/config_file/output`" );
     program.add_argument( "-a", "--agents" )
         .help( "Specify initial agent opinions in a file. Overwrites TOML config." );
-    program.add_argument( "-n", "--network" ).help( "Specify initial network in a file. Overwrites TOML config." );
+    program.add_argument( "-n", "--network" )
+        .help( "Specify initial network in a text or binary file. Overwrites TOML config." );
 
     try
     {
@@ -81,12 +82,12 @@ int main( int argc, char * argv[] )
         auto model_settings = std::get<Seldon::Config::DeffuantSettings>( simulation_options.model_settings );
         if( model_settings.use_binary_vector )
         {
-            simulation = std::make_unique<Seldon::Simulation<Seldon::DeffuantModelVector::AgentT>>(
+            simulation = std::make_unique<Seldon::Simulation<Seldon::DeffuantModelVector::AgentT, Seldon::Unweighted>>(
                 simulation_options, network_file, agent_file );
         }
         else
         {
-            simulation = std::make_unique<Seldon::Simulation<Seldon::DeffuantModel::AgentT>>(
+            simulation = std::make_unique<Seldon::Simulation<Seldon::DeffuantModel::AgentT, Seldon::Unweighted>>(
                 simulation_options, network_file, agent_file );
         }
     }
@@ -2,6 +2,7 @@
 #include "config_parser.hpp"
 #include <cmath>
 #include <iterator>
+#include <utility>
 
 namespace Seldon
 {
@@ -15,7 +16,7 @@ DeGrootModel::DeGrootModel( Config::DeGrootSettings settings, NetworkT & network
     // For a strongly connected network, the number of SCCs should be 1
     // Print a warning if this is not true
 
-    auto n_components = network.strongly_connected_components().size();
+    auto n_components = network.parallel_strongly_connected_components().size();
     if( n_components != 1 )
     {
         fmt::print( "WARNING: You have {} strongly connected components in your network!\n", n_components );
@@ -36,8 +37,8 @@ void DeGrootModel::iteration()
 
     for( size_t i = 0; i < network.agents.size(); i++ )
     {
-        auto neighbour_buffer               = network.get_neighbours( i );
-        auto weight_buffer                  = network.get_weights( i );
+        auto neighbour_buffer               = std::as_const( network ).get_neighbours( i );
+        auto weight_buffer                  = std::as_const( network ).get_weights( i );
         agents_current_copy[i].data.opinion = 0.0;
         for( size_t j = 0; j < neighbour_buffer.size(); j++ )
         {
@@ -24,6 +24,7 @@ TEST_CASE(
     auto input_file = proj_root_path / fs::path( "test/res/activity_probabilistic_conf.toml" );
 
     auto options = Config::parse_config_file( input_file.string() );
+    options.output_settings.output_connectivity = true;
 
     auto simulation = Simulation<AgentT>( options, std::nullopt, std::nullopt );
 
@@ -40,6 +41,13 @@ TEST_CASE(
 
     // The output directory should have some output files now
     REQUIRE_FALSE( fs::is_empty( output_dir_path ) );
+    REQUIRE( fs::exists( output_dir_path / fs::path( "connectivity.txt" ) ) );
+
+    // The tracked connectivity belongs to the network of the last iteration
+    auto connectivity = simulation.model->connectivity_stats();
+    REQUIRE( connectivity.has_value() );
+    auto components = simulation.network.weakly_connected_components();
+    REQUIRE( connectivity->n_components == components.size() );
 
     // Cleanup
     fs::remove_all( output_dir_path );
@@ -24,7 +24,7 @@ TEST_CASE( "Test the basic deffuant model for two agents", "[deffuantTwoAgents]"
 
     auto options = Config::parse_config_file( input_file.string() );
 
-    auto simulation = Simulation<AgentT>( options, std::nullopt, std::nullopt );
+    auto simulation = Simulation<AgentT, Unweighted>( options, std::nullopt, std::nullopt );
 
     // We need an output path for Simulation, but we won't write anything out there
     fs::path output_dir_path = proj_root_path / fs::path( "test/output_deffuant" );
@@ -75,7 +75,7 @@ TEST_CASE( "Test the lattice deffuant model for 16x16 agents", "[deffuantLattice
 
     auto options = Config::parse_config_file( input_file.string() );
 
-    auto simulation = Simulation<AgentT>( options, std::nullopt, std::nullopt );
+    auto simulation = Simulation<AgentT, Unweighted>( options, std::nullopt, std::nullopt );
 
     // We need an output path for Simulation, but we won't write anything out there
     fs::path output_dir_path = proj_root_path / fs::path( "test/output_deffuant" );
@@ -129,7 +129,7 @@ TEST_CASE(
 
     auto options = Config::parse_config_file( input_file.string() );
 
-    auto simulation = Simulation<AgentT>( options, std::nullopt, std::nullopt );
+    auto simulation = Simulation<AgentT, Unweighted>( options, std::nullopt, std::nullopt );
 
     // We need an output path for Simulation, but we won't write anything out there
     fs::path output_dir_path = proj_root_path / fs::path( "test/output_deffuant_vector" );
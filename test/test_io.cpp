@@ -3,16 +3,54 @@
 #include "models/ActivityDrivenModel.hpp"
 #include "network.hpp"
 #include "network_generation.hpp"
+#include "network_io.hpp"
+#include "network_reordering.hpp"
 
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
 #include <catch2/matchers/catch_matchers_range_equals.hpp>
 
 #include <config_parser.hpp>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <simulation.hpp>
 namespace fs = std::filesystem;
 
+namespace Seldon
+{
+// An agent type that is read with agent_from_string from a std::string ...
+struct StringAgentData
+{
+    double opinion = 0;
+};
+using StringAgent = Agent<StringAgentData>;
+
+template<>
+inline StringAgent agent_from_string<StringAgent>( std::string_view str )
+{
+    StringAgent res{};
+    res.data.opinion = std::stod( std::string( str ) );
+    return res;
+}
+
+// ... and written with agent_to_string
+template<>
+inline std::string agent_to_string<StringAgent>( const StringAgent & agent )
+{
+    return fmt::format( "{}", agent.data.opinion );
+}
+
+// An agent type that specialises nothing
+struct PlainAgentData
+{
+    double opinion = 0.5;
+};
+using PlainAgent = Agent<PlainAgentData>;
+} // namespace Seldon
+
 TEST_CASE( "Test reading in the network from a file", "[io_network]" )
 {
     using namespace Seldon;
@@ -61,4 +99,278 @@ TEST_CASE( "Test reading in the agents from a file", "[io_agents]" )
         REQUIRE_THAT( agents[i].data.activity, Catch::Matchers::WithinAbs( activities_expected[i], 1e-16 ) );
         REQUIRE_THAT( agents[i].data.reluctance, Catch::Matchers::WithinAbs( reluctances_expected[i], 1e-16 ) );
     }
+
+    // A line with only the opinion uses it for the activity as well
+    auto agent_opinion_only = agent_from_string<ActivityDrivenModel::AgentT>( std::string_view( " 0.25" ) );
+    REQUIRE( agent_opinion_only.data.opinion == 0.25 );
+    REQUIRE( agent_opinion_only.data.activity == 0.25 );
+    REQUIRE( agent_opinion_only.data.reluctance == 1.0 );
+
+    // agent_from_string can be called with a std::string or a string literal as well
+    REQUIRE( agent_from_string<ActivityDrivenModel::AgentT>( std::string( "0.5, 0.1" ) ).data.activity == 0.1 );
+    REQUIRE( agent_from_string<ActivityDrivenModel::AgentT>( "0.5, 0.1" ).data.activity == 0.1 );
+    REQUIRE( agent_from_string<StringAgent>( "0.5, 0.1" ).data.opinion == 0.5 );
+
+    // Without a specialisation, the agents are default constructed
+    REQUIRE( agent_from_string<PlainAgent>( "0.25" ).data.opinion == 0.5 );
+    auto plain_agents = Seldon::agents_from_file<PlainAgent>( network_file );
+    REQUIRE( plain_agents.size() == 3 );
+    REQUIRE( plain_agents[2].data.opinion == 0.5 );
+    auto string_agents = Seldon::agents_from_file<StringAgent>( network_file );
+    REQUIRE( string_agents.size() == 3 );
+    for( size_t i = 0; i < string_agents.size(); i++ )
+    {
+        REQUIRE_THAT( string_agents[i].data.opinion, Catch::Matchers::WithinAbs( opinions_expected[i], 1e-16 ) );
+    }
+
+    // An agent type can specialise agent_to_string, which agents_to_file falls back on
+    REQUIRE( agent_to_string( string_agents[0] ) == fmt::format( "{}", opinions_expected[0] ) );
+    const Network<StringAgent> string_network( string_agents );
+    const auto string_agents_file = ( fs::temp_directory_path() / "string_agents.txt" ).string();
+    agents_to_file( string_network, string_agents_file );
+    REQUIRE(
+        get_file_contents( string_agents_file )
+        == fmt::format(
+            "# idx_agent, agent_data[...]\n{:>5}, {:>25}\n{:>5}, {:>25}\n{:>5}, {:>25}\n", 0, opinions_expected[0], 1,
+            opinions_expected[1], 2, opinions_expected[2] ) );
+
+    // ... or format_agent_to, which agent_to_string uses as well
+    REQUIRE( agent_to_string( agents[2] ) == "-0.8802809369462433, 0.015863953902810535, 2.3" );
+
+    // Without a specialisation, the agents are written without columns
+    REQUIRE( agent_to_string( plain_agents[0] ).empty() );
+    const Network<PlainAgent> plain_network( plain_agents );
+    const auto plain_agents_file = ( fs::temp_directory_path() / "plain_agents.txt" ).string();
+    agents_to_file( plain_network, plain_agents_file );
+    REQUIRE(
+        get_file_contents( plain_agents_file )
+        == fmt::format(
+            "# idx_agent, agent_data[...]\n{0:>5}, {1:>25}\n{2:>5}, {1:>25}\n{3:>5}, {1:>25}\n", 0, "", 1, 2 ) );
+}
+
+TEST_CASE( "Test reading large text files in parallel", "[io_parallel]" )
+{
+    using namespace Seldon;
+    using namespace Catch::Matchers;
+    using AgentT = ActivityDrivenModel::AgentT;
+
+    // Large enough to be split into several chunks
+    std::mt19937 gen( 0 );
+    auto network = NetworkGeneration::generate_n_connections<AgentT>( 10000, 10, true, gen );
+    for( size_t i = 0; i < network.n_agents(); i++ )
+    {
+        network.agents[i].data.opinion  = 0.001 * double( i );
+        network.agents[i].data.activity = 1.0 / double( i + 1 );
+    }
+
+    auto output_dir   = fs::temp_directory_path();
+    auto network_file = ( output_dir / "network_parallel.txt" ).string();
+    auto agents_file  = ( output_dir / "agents_parallel.txt" ).string();
+    network_to_file( network, network_file );
+    agents_to_file( network, agents_file );
+
+    for( size_t n_threads : { 1, 4 } )
+    {
+        Parallel::set_n_threads( n_threads );
+        auto network_read = NetworkGeneration::generate_from_file<AgentT>( network_file );
+        auto agents_read  = agents_from_file<AgentT>( agents_file );
+
+        REQUIRE( network_read.n_agents() == network.n_agents() );
+        REQUIRE( agents_read.size() == network.n_agents() );
+        for( size_t i = 0; i < network.n_agents(); i++ )
+        {
+            REQUIRE_THAT( network_read.get_neighbours( i ), RangeEquals( network.get_neighbours( i ) ) );
+            REQUIRE_THAT( network_read.get_weights( i ), RangeEquals( network.get_weights( i ) ) );
+            REQUIRE( agents_read[i].data.opinion == network.agents[i].data.opinion );
+            REQUIRE( agents_read[i].data.activity == network.agents[i].data.activity );
+        }
+    }
+    Parallel::set_n_threads( 0 );
+}
+
+TEST_CASE( "Test the exact format of the written network and agents", "[io_write_format]" )
+{
+    using namespace Seldon;
+    using AgentT  = ActivityDrivenModel::AgentT;
+    using Network = Network<AgentT>;
+
+    std::vector<std::vector<DefaultIndexT>> neighbours = { { 2, 1 }, {}, { 0 } };
+    std::vector<std::vector<double>> weights           = { { 0.1, -0.2 }, {}, { 1.5 } };
+    Network network( std::move( neighbours ), std::move( weights ), Network::EdgeDirection::Incoming );
+    network.agents[0].data.opinion    = 0.5;
+    network.agents[0].data.activity   = 1e-5;
+    network.agents[2].data.reluctance = 2;
+
+    auto output_dir   = fs::temp_directory_path();
+    auto network_file = ( output_dir / "network_format.txt" ).string();
+    auto agents_file  = ( output_dir / "agents_format.txt" ).string();
+    network_to_file( network, network_file );
+    agents_to_file( network, agents_file );
+
+    // The last row of the network does not end with a newline
+    REQUIRE(
+        get_file_contents( network_file )
+        == "# idx_agent, n_neighbours_in, indices_neighbours_in[...], weights_in[...]\n"
+           "    0,     2,     2,     1,                       0.1,                      -0.2\n"
+           "    1,     0\n"
+           "    2,     1,     0,                       1.5" );
+    REQUIRE(
+        get_file_contents( agents_file )
+        == "# idx_agent, opinion, activity, reluctance\n"
+           "    0,             0.5, 1e-05, 1\n"
+           "    1,                   0, 0, 1\n"
+           "    2,                   0, 0, 2\n" );
+}
+
+TEST_CASE( "Test that the written files do not depend on the number of threads", "[io_write_parallel]" )
+{
+    using namespace Seldon;
+    using AgentT = ActivityDrivenModel::AgentT;
+
+    // Large enough to be written in several blocks of several chunks
+    std::mt19937 gen( 0 );
+    auto network = NetworkGeneration::generate_n_connections<AgentT>( 40000, 3, true, gen );
+    for( size_t i = 0; i < network.n_agents(); i++ )
+    {
+        network.agents[i].data.opinion = std::sin( double( i ) );
+    }
+    network.permute_agents( NetworkReordering::reverse_cuthill_mckee( network ) );
+
+    auto output_dir = fs::temp_directory_path();
+    std::vector<std::string> network_contents{};
+    std::vector<std::string> agents_contents{};
+    for( size_t n_threads : { 1, 3 } )
+    {
+        Parallel::set_n_threads( n_threads );
+        auto network_file = ( output_dir / fmt::format( "network_threads_{}.txt", n_threads ) ).string();
+        auto agents_file  = ( output_dir / fmt::format( "agents_threads_{}.txt", n_threads ) ).string();
+        network_to_file( network, network_file );
+        agents_to_file( network, agents_file );
+        network_contents.push_back( get_file_contents( network_file ) );
+        agents_contents.push_back( get_file_contents( agents_file ) );
+    }
+    Parallel::set_n_threads( 0 );
+
+    REQUIRE( network_contents[0] == network_contents[1] );
+    REQUIRE( agents_contents[0] == agents_contents[1] );
+}
+
+TEST_CASE( "Test that relabeled agents are written with their original indices", "[io_relabeled]" )
+{
+    using namespace Seldon;
+    using AgentT = ActivityDrivenModel::AgentT;
+
+    std::mt19937 gen( 0 );
+    auto network = NetworkGeneration::generate_n_connections<AgentT>( 50, 4, true, gen );
+    for( auto & agent : network.agents )
+    {
+        agent.data.opinion = std::uniform_real_distribution<double>( -1, 1 )( gen );
+    }
+
+    auto network_relabeled = network;
+    network_relabeled.permute_agents( NetworkReordering::reverse_cuthill_mckee( network_relabeled ) );
+
+    auto output_dir = fs::temp_directory_path();
+    network_to_file( network, ( output_dir / "network_original.txt" ).string() );
+    network_to_file( network_relabeled, ( output_dir / "network_relabeled.txt" ).string() );
+    agents_to_file( network, ( output_dir / "opinions_original.txt" ).string() );
+    agents_to_file( network_relabeled, ( output_dir / "opinions_relabeled.txt" ).string() );
+
+    REQUIRE(
+        get_file_contents( ( output_dir / "network_original.txt" ).string() )
+        == get_file_contents( ( output_dir / "network_relabeled.txt" ).string() ) );
+    REQUIRE(
+        get_file_contents( ( output_dir / "opinions_original.txt" ).string() )
+        == get_file_contents( ( output_dir / "opinions_relabeled.txt" ).string() ) );
+}
+
+TEST_CASE( "Test writing and reading the binary network format", "[io_binary_network]" )
+{
+    using namespace Seldon;
+    using namespace Catch::Matchers;
+    using AgentT = ActivityDrivenModel::AgentT;
+
+    std::mt19937 gen( 0 );
+    auto network    = NetworkGeneration::generate_n_connections<AgentT>( 200, 6, true, gen );
+    auto output_dir = fs::temp_directory_path();
+    auto file       = ( output_dir / "network_binary.bin" ).string();
+
+    SECTION( "A round trip gives the same network, also through generate_from_file" )
+    {
+        network_to_binary_file( network, file );
+        REQUIRE( is_binary_network_file( file ) );
+        REQUIRE( !is_binary_network_file( ( fs::current_path() / fs::path( "test/res/network.txt" ) ).string() ) );
+
+        auto network_binary = NetworkGeneration::generate_from_binary_file<AgentT>( file );
+        auto network_any    = NetworkGeneration::generate_from_file<AgentT>( file );
+        REQUIRE( network_binary.n_agents() == network.n_agents() );
+        REQUIRE( network_binary.storage() == Seldon::Network<AgentT>::StorageType::CSR );
+        for( size_t i = 0; i < network.n_agents(); i++ )
+        {
+            REQUIRE_THAT( network_binary.get_neighbours( i ), RangeEquals( network.get_neighbours( i ) ) );
+            REQUIRE_THAT( network_binary.get_weights( i ), RangeEquals( network.get_weights( i ) ) );
+            REQUIRE_THAT( network_any.get_neighbours( i ), RangeEquals( network.get_neighbours( i ) ) );
+            REQUIRE_THAT( network_any.get_weights( i ), RangeEquals( network.get_weights( i ) ) );
+        }
+    }
+
+    SECTION( "Relabeled agents, other index and weight types and the direction are converted" )
+    {
+        auto network_relabeled = network;
+        network_relabeled.permute_agents( NetworkReordering::reverse_cuthill_mckee( network_relabeled ) );
+        network_relabeled.toggle_incoming_outgoing();
+        network_to_binary_file( network_relabeled, file );
+
+        auto network_narrow = NetworkGeneration::generate_from_binary_file<AgentT, float, uint32_t>( file );
+        auto network_unweighted = NetworkGeneration::generate_from_binary_file<AgentT, Unweighted>( file );
+        REQUIRE( network_narrow.direction() == decltype( network_narrow )::EdgeDirection::Outgoing );
+
+        network.toggle_incoming_outgoing();
+        for( size_t i = 0; i < network.n_agents(); i++ )
+        {
+            REQUIRE_THAT( network_narrow.get_neighbours( i ), UnorderedRangeEquals( network.get_neighbours( i ) ) );
+            REQUIRE_THAT( network_unweighted.get_neighbours( i ), UnorderedRangeEquals( network.get_neighbours( i ) ) );
+            auto weights = network.get_weights( i );
+            std::vector<float> weights_narrow( weights.begin(), weights.end() );
+            REQUIRE_THAT( network_narrow.get_weights( i ), UnorderedRangeEquals( weights_narrow ) );
+        }
+
+        // An unweighted file gives the weight 1 to every edge
+        network_to_binary_file( network_unweighted, file );
+        auto network_weighted = NetworkGeneration::generate_from_binary_file<AgentT>( file );
+        REQUIRE( network_weighted.n_edges() == network.n_edges() );
+        for( size_t i = 0; i < network.n_agents(); i++ )
+        {
+            for( auto w : network_weighted.get_weights( i ) )
+            {
+                REQUIRE( w == 1.0 );
+            }
+        }
+    }
+
+    SECTION( "Broken files are rejected" )
+    {
+        network_to_binary_file( network, file );
+        auto contents = get_file_contents( file );
+
+        // Truncated
+        std::ofstream( file, std::ios::binary ).write( contents.data(), std::streamsize( contents.size() - 8 ) );
+        REQUIRE_THROWS( NetworkGeneration::generate_from_binary_file<AgentT>( file ) );
+
+        // A neighbour that is not an agent
+        auto broken = contents;
+        BinaryNetworkHeader header{};
+        std::memcpy( &header, broken.data(), sizeof( header ) );
+        const std::uint64_t too_large = 1000;
+        std::memcpy( broken.data() + header.neighbours_begin(), &too_large, sizeof( too_large ) );
+        std::ofstream( file, std::ios::binary ).write( broken.data(), std::streamsize( broken.size() ) );
+        REQUIRE_THROWS( NetworkGeneration::generate_from_binary_file<AgentT>( file ) );
+
+        // An unknown version
+        broken             = contents;
+        header.version     = 2;
+        std::memcpy( broken.data(), &header, sizeof( header ) );
+        std::ofstream( file, std::ios::binary ).write( broken.data(), std::streamsize( broken.size() ) );
+        REQUIRE_THROWS( NetworkGeneration::generate_from_binary_file<AgentT>( file ) );
+    }
 }
\ No newline at end of file
@@ -1,10 +1,16 @@
 #include "network.hpp"
 #include "network_generation.hpp"
+#include "network_reordering.hpp"
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_range_equals.hpp>
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <map>
+#include <numeric>
 #include <random>
 #include <set>
+#include <type_traits>
 
 TEST_CASE( "Testing the network class" )
 {
@@ -160,7 +166,11 @@ TEST_CASE( "Testing the network class" )
         auto network = Seldon::Network<double>(
             std::move( neighbour_list ), std::move( weight_list ), Seldon::Network<double>::EdgeDirection::Incoming );
 
+        auto network_csr = network;
+        network_csr.set_storage( Seldon::Network<double>::StorageType::CSR );
+
         network.remove_double_counting();
+        network_csr.remove_double_counting();
 
         for( size_t i_agent = 0; i_agent < network.n_agents(); i_agent++ )
         {
@@ -169,7 +179,529 @@ TEST_CASE( "Testing the network class" )
             fmt::print( "i_agent {}\n", i_agent );
             REQUIRE_THAT( neighbours, Catch::Matchers::RangeEquals( neighbour_no_double_counting[i_agent] ) );
             REQUIRE_THAT( weights, Catch::Matchers::RangeEquals( weights_no_double_counting[i_agent] ) );
+            REQUIRE_THAT(
+                network_csr.get_neighbours( i_agent ),
+                Catch::Matchers::RangeEquals( neighbour_no_double_counting[i_agent] ) );
+            REQUIRE_THAT(
+                network_csr.get_weights( i_agent ),
+                Catch::Matchers::RangeEquals( weights_no_double_counting[i_agent] ) );
+        }
+
+        // A large network with many double edges gives the same result on several threads
+        const size_t n_agents_large = 20000;
+        std::uniform_int_distribution<size_t> dist_neighbour( 0, 9 );
+        std::vector<std::vector<size_t>> neighbour_list_large( n_agents_large );
+        std::vector<std::vector<double>> weight_list_large( n_agents_large );
+        std::vector<std::map<size_t, double>> expected( n_agents_large );
+        for( size_t i_agent = 0; i_agent < n_agents_large; i_agent++ )
+        {
+            for( size_t i_edge = 0; i_edge < 8; i_edge++ )
+            {
+                const auto neighbour = ( i_agent + dist_neighbour( gen ) ) % n_agents_large;
+                neighbour_list_large[i_agent].push_back( neighbour );
+                weight_list_large[i_agent].push_back( 0.25 * double( i_edge ) );
+                expected[i_agent][neighbour] += 0.25 * double( i_edge );
+            }
+        }
+
+        auto network_large = Seldon::Network<double>(
+            std::move( neighbour_list_large ), std::move( weight_list_large ),
+            Seldon::Network<double>::EdgeDirection::Incoming );
+        auto network_large_csr = network_large;
+        network_large_csr.set_storage( Seldon::Network<double>::StorageType::CSR );
+
+        Seldon::Parallel::set_n_threads( 4 );
+        network_large.remove_double_counting();
+        network_large_csr.remove_double_counting();
+        Seldon::Parallel::set_n_threads( 0 );
+
+        for( size_t i_agent = 0; i_agent < n_agents_large; i_agent++ )
+        {
+            std::vector<size_t> neighbours_expected{};
+            std::vector<double> weights_expected{};
+            for( const auto & [neighbour, weight] : expected[i_agent] )
+            {
+                neighbours_expected.push_back( neighbour );
+                weights_expected.push_back( weight );
+            }
+            REQUIRE_THAT(
+                network_large.get_neighbours( i_agent ), Catch::Matchers::RangeEquals( neighbours_expected ) );
+            REQUIRE_THAT( network_large.get_weights( i_agent ), Catch::Matchers::RangeEquals( weights_expected ) );
+            REQUIRE_THAT(
+                network_large_csr.get_neighbours( i_agent ), Catch::Matchers::RangeEquals( neighbours_expected ) );
+            REQUIRE_THAT( network_large_csr.get_weights( i_agent ), Catch::Matchers::RangeEquals( weights_expected ) );
+        }
+    }
+
+    SECTION( "Checking that the CSR storage gives the same network as the adjacency list" )
+    {
+        auto network_csr = network;
+        network_csr.set_storage( Network::StorageType::CSR );
+        REQUIRE( network_csr.storage() == Network::StorageType::CSR );
+        REQUIRE( network_csr.n_edges() == network.n_edges() );
+
+        for( size_t i_agent = 0; i_agent < network.n_agents(); i_agent++ )
+        {
+            REQUIRE_THAT(
+                network_csr.get_neighbours( i_agent ),
+                Catch::Matchers::RangeEquals( network.get_neighbours( i_agent ) ) );
+            REQUIRE_THAT(
+                network_csr.get_weights( i_agent ), Catch::Matchers::RangeEquals( network.get_weights( i_agent ) ) );
+        }
+
+        // Setting the same number of neighbours keeps the CSR format
+        std::vector<size_t> buffer_n{ { 1, 4 } };
+        std::vector<Network::WeightT> buffer_w{ 0.3, 0.7 };
+        network_csr.set_neighbours_and_weights( 3, buffer_n, buffer_w );
+        REQUIRE( network_csr.storage() == Network::StorageType::CSR );
+        REQUIRE_THAT( network_csr.get_neighbours( 3 ), Catch::Matchers::RangeEquals( buffer_n ) );
+        REQUIRE_THAT( network_csr.get_weights( 3 ), Catch::Matchers::RangeEquals( buffer_w ) );
+
+        // Toggling twice gives back the same edges (sorted by index within each row)
+        network.set_neighbours_and_weights( 3, buffer_n, buffer_w );
+        network_csr.toggle_incoming_outgoing();
+        REQUIRE( network_csr.direction() == Network::EdgeDirection::Outgoing );
+        network_csr.toggle_incoming_outgoing();
+        REQUIRE( network_csr.n_edges() == network.n_edges() );
+        for( size_t i_agent = 0; i_agent < network.n_agents(); i_agent++ )
+        {
+            REQUIRE_THAT(
+                network_csr.get_neighbours( i_agent ),
+                Catch::Matchers::UnorderedRangeEquals( network.get_neighbours( i_agent ) ) );
+            REQUIRE_THAT(
+                network_csr.get_weights( i_agent ),
+                Catch::Matchers::UnorderedRangeEquals( network.get_weights( i_agent ) ) );
+        }
+
+        // Changing the number of edges converts back to adjacency lists
+        network_csr.push_back_neighbour_and_weight( 3, 5, 1.0 );
+        REQUIRE( network_csr.storage() == Network::StorageType::AdjacencyList );
+        REQUIRE( network_csr.n_edges( 3 ) == 3 );
+        REQUIRE( network_csr.n_edges() == network.n_edges() + 1 );
+    }
+
+    SECTION( "Checking that the parallel transpose gives the same result as the serial one" )
+    {
+        const size_t n_agents_large = 40000;
+        auto network_serial = NetworkGeneration::generate_n_connections<double>( n_agents_large, 5, true, gen );
+        network_serial.push_back_neighbour_and_weight( 7, 3, 0.5 ); // Add a double edge, which must keep its order
+        auto network_parallel = network_serial;
+        auto network_csr      = network_serial;
+        network_csr.set_storage( Network::StorageType::CSR );
+
+        Seldon::Parallel::set_n_threads( 1 );
+        network_serial.toggle_incoming_outgoing();
+        Seldon::Parallel::set_n_threads( 4 );
+        network_parallel.toggle_incoming_outgoing();
+        network_csr.toggle_incoming_outgoing();
+        Seldon::Parallel::set_n_threads( 0 );
+
+        for( size_t i_agent = 0; i_agent < n_agents_large; i_agent++ )
+        {
+            REQUIRE_THAT(
+                network_parallel.get_neighbours( i_agent ),
+                Catch::Matchers::RangeEquals( network_serial.get_neighbours( i_agent ) ) );
+            REQUIRE_THAT(
+                network_parallel.get_weights( i_agent ),
+                Catch::Matchers::RangeEquals( network_serial.get_weights( i_agent ) ) );
+            REQUIRE_THAT(
+                network_csr.get_neighbours( i_agent ),
+                Catch::Matchers::RangeEquals( network_serial.get_neighbours( i_agent ) ) );
+            REQUIRE_THAT(
+                network_csr.get_weights( i_agent ),
+                Catch::Matchers::RangeEquals( network_serial.get_weights( i_agent ) ) );
+        }
+    }
+
+    SECTION( "Checking that a network with 32 bit indices gives the same results" )
+    {
+        using NetworkNarrow = Seldon::Network<double, double, uint32_t>;
+        std::mt19937 gen_narrow( 0 );
+        auto network_narrow = NetworkGeneration::generate_n_connections<double, double, uint32_t>(
+            n_agents, n_connections, false, gen_narrow );
+        static_assert( std::is_same_v<decltype( network_narrow ), NetworkNarrow> );
+
+        std::mt19937 gen_wide( 0 );
+        auto network_wide
+            = NetworkGeneration::generate_n_connections<double>( n_agents, n_connections, false, gen_wide );
+
+        network_narrow.toggle_incoming_outgoing();
+        network_wide.toggle_incoming_outgoing();
+        for( size_t i_agent = 0; i_agent < n_agents; i_agent++ )
+        {
+            REQUIRE_THAT(
+                network_narrow.get_neighbours( i_agent ),
+                Catch::Matchers::RangeEquals( network_wide.get_neighbours( i_agent ) ) );
+            REQUIRE_THAT(
+                network_narrow.get_weights( i_agent ),
+                Catch::Matchers::RangeEquals( network_wide.get_weights( i_agent ) ) );
+        }
+        REQUIRE(
+            network_narrow.strongly_connected_components().size()
+            == network_wide.strongly_connected_components().size() );
+
+        // The index type has to be able to hold every agent index
+        REQUIRE_NOTHROW( Seldon::Network<double, double, uint8_t>( 256 ) );
+        REQUIRE_THROWS( Seldon::Network<double, double, uint8_t>( 257 ) );
+    }
+
+    SECTION( "Checking that an unweighted network has the same edges with constant weights" )
+    {
+        using NetworkUnweighted = Seldon::Network<double, Seldon::Unweighted>;
+        static_assert( !NetworkUnweighted::is_weighted );
+
+        auto lattice            = NetworkGeneration::generate_square_lattice<double>( 5, 0.0 );
+        auto lattice_unweighted = NetworkGeneration::generate_square_lattice<double, Seldon::Unweighted>( 5 );
+        lattice_unweighted.push_back_neighbour_and_weight( 3, 4, 0.5 ); // The weight gets ignored
+        lattice.push_back_neighbour_and_weight( 3, 4, 0.5 );
+
+        auto check_same_edges = [&]()
+        {
+            REQUIRE( lattice_unweighted.n_edges() == lattice.n_edges() );
+            for( size_t i_agent = 0; i_agent < lattice.n_agents(); i_agent++ )
+            {
+                REQUIRE_THAT(
+                    lattice_unweighted.get_neighbours( i_agent ),
+                    Catch::Matchers::RangeEquals( lattice.get_neighbours( i_agent ) ) );
+                auto weights = lattice_unweighted.get_weights( i_agent );
+                REQUIRE( weights.size() == lattice.n_edges( i_agent ) );
+                for( const auto & w : weights )
+                {
+                    REQUIRE( w == 1.0 );
+                }
+            }
+        };
+        check_same_edges();
+
+        lattice_unweighted.toggle_incoming_outgoing();
+        lattice.toggle_incoming_outgoing();
+        check_same_edges();
+
+        lattice_unweighted.set_storage( NetworkUnweighted::StorageType::CSR );
+        lattice_unweighted.remove_double_counting();
+        lattice.remove_double_counting();
+        check_same_edges();
+
+        lattice_unweighted.set_dual_direction( true );
+        lattice_unweighted.toggle_incoming_outgoing();
+        lattice.toggle_incoming_outgoing();
+        check_same_edges();
+    }
+
+    SECTION( "Checking that the dual direction mode keeps both directions in sync" )
+    {
+        auto network_dual = NetworkGeneration::generate_n_connections<double>( n_agents, 3, true, gen );
+        for( size_t i_agent = 0; i_agent < n_agents; i_agent++ )
+        {
+            std::vector<double> weights( network_dual.n_edges( i_agent ) );
+            std::iota( weights.begin(), weights.end(), double( i_agent ) );
+            network_dual.set_weights( i_agent, weights );
+        }
+        network_dual.set_dual_direction( true );
+        REQUIRE( network_dual.dual_direction() );
+
+        // Both directions have to match the (expensive) transpose of a plain network
+        auto check_against_transpose = [&]()
+        {
+            auto network_plain = network_dual;
+            network_plain.set_dual_direction( false );
+            auto direction_stored = network_plain.direction();
+            network_plain.toggle_incoming_outgoing();
+            for( size_t i_agent = 0; i_agent < n_agents; i_agent++ )
+            {
+                REQUIRE_THAT(
+                    network_dual.get_neighbours( i_agent, network_plain.direction() ),
+                    Catch::Matchers::UnorderedRangeEquals( network_plain.get_neighbours( i_agent ) ) );
+                REQUIRE_THAT(
+                    network_dual.get_weights( i_agent, network_plain.direction() ),
+                    Catch::Matchers::UnorderedRangeEquals( network_plain.get_weights( i_agent ) ) );
+                REQUIRE_THAT(
+                    network_dual.get_neighbours( i_agent, direction_stored ),
+                    Catch::Matchers::RangeEquals( network_dual.get_neighbours( i_agent ) ) );
+            }
+        };
+        check_against_transpose();
+
+        // Toggling only swaps the two directions
+        auto network_toggled = network_dual;
+        network_toggled.set_dual_direction( false );
+        network_toggled.toggle_incoming_outgoing();
+        network_dual.toggle_incoming_outgoing();
+        REQUIRE( network_dual.direction() == network_toggled.direction() );
+        for( size_t i_agent = 0; i_agent < n_agents; i_agent++ )
+        {
+            REQUIRE_THAT(
+                network_dual.get_neighbours( i_agent ),
+                Catch::Matchers::RangeEquals( network_toggled.get_neighbours( i_agent ) ) );
+            REQUIRE_THAT(
+                network_dual.get_weights( i_agent ),
+                Catch::Matchers::RangeEquals( network_toggled.get_weights( i_agent ) ) );
+        }
+        check_against_transpose();
+
+        // The single-row mutations update the other direction
+        std::vector<size_t> neighbours{ 5, 2, 5, 8 };
+        std::vector<double> weights{ 0.5, 1.5, 2.5, 3.5 };
+        network_dual.set_neighbours_and_weights( 0, neighbours, weights );
+        network_dual.set_neighbours_and_weights( 3, neighbours, 0.25 );
+        network_dual.push_back_neighbour_and_weight( 9, 0, -1.0 );
+        check_against_transpose();
+
+        std::vector<double> weights_new{ 4.0, 3.0, 2.0, 1.0 };
+        network_dual.set_weights( 0, weights_new );
+        check_against_transpose();
+
+        // The bulk update only rebuilds the other direction at the end
+        network_dual.set_storage( Network::StorageType::CSR );
+        network_dual.bulk_update(
+            [&]()
+            {
+                for( size_t i_agent = 0; i_agent < n_agents; i_agent++ )
+                {
+                    for( auto & w : network_dual.get_weights( i_agent ) )
+                    {
+                        w *= 2.0;
+                    }
+                }
+                REQUIRE_THROWS( network_dual.get_weights( 0, Network::EdgeDirection::Incoming ) );
+            } );
+        REQUIRE( network_dual.dual_direction() );
+        REQUIRE( network_dual.storage() == Network::StorageType::CSR );
+        check_against_transpose();
+
+        network_dual.set_dual_direction( false );
+        REQUIRE_THROWS( network_dual.get_weights( 0, Network::EdgeDirection::Incoming ) );
+    }
+
+    SECTION( "Checking that the implicit fully connected storage behaves like the materialised network" )
+    {
+        const size_t n_agents_full = 5;
+        auto network_full          = NetworkGeneration::generate_fully_connected<double>( n_agents_full, gen );
+        REQUIRE( network_full.storage() == Network::StorageType::FullyConnected );
+        REQUIRE( network_full.n_edges() == n_agents_full * n_agents_full );
+
+        auto network_csr = network_full;
+        network_csr.set_storage( Network::StorageType::CSR );
+        REQUIRE( network_csr.storage() == Network::StorageType::CSR );
+
+        // The agents share one row of neighbours, which can only be read through a const network
+        const auto & network_full_const = network_full;
+        REQUIRE_THROWS( network_full.get_neighbours( 0 ) );
+
+        std::vector<size_t> all_agents( n_agents_full );
+        std::iota( all_agents.begin(), all_agents.end(), 0 );
+        for( size_t i_agent = 0; i_agent < n_agents_full; i_agent++ )
+        {
+            REQUIRE_THAT( network_full_const.get_neighbours( i_agent ), Catch::Matchers::RangeEquals( all_agents ) );
+            REQUIRE_THAT(
+                network_csr.get_neighbours( i_agent ),
+                Catch::Matchers::RangeEquals( network_full_const.get_neighbours( i_agent ) ) );
+            REQUIRE_THAT(
+                network_csr.get_weights( i_agent ),
+                Catch::Matchers::RangeEquals( network_full.get_weights( i_agent ) ) );
         }
+
+        // Writing weights in place keeps the implicit storage, toggling transposes the weights
+        std::vector<Network::WeightT> buffer_w{ 0.1, 0.2, 0.3, 0.4, 0.5 };
+        network_full.set_weights( 2, buffer_w );
+        network_csr.set_weights( 2, buffer_w );
+        REQUIRE( network_full.storage() == Network::StorageType::FullyConnected );
+
+        // ... also when the other direction is kept, which reads the shared row internally
+        auto network_full_dual = network_full;
+        network_full_dual.set_dual_direction( true );
+        network_full_dual.set_weights( 3, buffer_w );
+        REQUIRE( network_full_dual.get_weights( 1, Network::EdgeDirection::Outgoing )[3] == buffer_w[1] );
+
+        network_full.toggle_incoming_outgoing();
+        network_csr.toggle_incoming_outgoing();
+        REQUIRE( network_full.storage() == Network::StorageType::FullyConnected );
+        for( size_t i_agent = 0; i_agent < n_agents_full; i_agent++ )
+        {
+            REQUIRE( network_full.get_weights( i_agent )[2] == buffer_w[i_agent] );
+            REQUIRE_THAT(
+                network_csr.get_weights( i_agent ),
+                Catch::Matchers::RangeEquals( network_full.get_weights( i_agent ) ) );
+        }
+
+        // Both networks have the same strongly connected components
+        REQUIRE( network_full.strongly_connected_components() == network_csr.strongly_connected_components() );
+        auto sorted_components = network_csr.strongly_connected_components();
+        sorted_components.sort();
+        REQUIRE( network_full.parallel_strongly_connected_components( 2 ) == sorted_components );
+        REQUIRE( network_csr.parallel_strongly_connected_components( 2 ) == sorted_components );
+        REQUIRE( network_full.condensation().n_components() == sorted_components.size() );
+        REQUIRE( network_csr.condensation().n_components() == sorted_components.size() );
+        REQUIRE( network_full.weakly_connected_components() == network_csr.weakly_connected_components() );
+
+        // A complete network can be stored implicitly again, an incomplete one can not
+        network_csr.set_storage( Network::StorageType::FullyConnected );
+        REQUIRE( network_csr.storage() == Network::StorageType::FullyConnected );
+        REQUIRE_THROWS( network.set_storage( Network::StorageType::FullyConnected ) );
+
+        // Agents outside of the network are not neighbours of an implicitly stored complete network
+        REQUIRE( network_csr.has_edge( n_agents_full - 1, 0 ) );
+        REQUIRE_FALSE( network_csr.has_edge( n_agents_full, 0 ) );
+        REQUIRE_FALSE( network_csr.has_edge( 0, n_agents_full ) );
+        REQUIRE_FALSE( network_csr.edge_weight( n_agents_full + 3, 1 ).has_value() );
+        REQUIRE_FALSE( network_csr.edge_weight( 1, n_agents_full + 3 ).has_value() );
+
+        // Changing the neighbours of an agent materialises the network
+        network_full.set_neighbours_and_weights( 1, std::vector<size_t>{ 0, 3 }, 1.0 );
+        REQUIRE( network_full.storage() == Network::StorageType::AdjacencyList );
+        REQUIRE( network_full.n_edges() == n_agents_full * n_agents_full - 3 );
+        REQUIRE_THAT( network_full.get_neighbours( 4 ), Catch::Matchers::RangeEquals( all_agents ) );
+    }
+
+    SECTION( "Checking that has_edge and edge_weight find the edges with and without sorted rows" )
+    {
+        network.push_back_neighbour_and_weight( 5, 2, 0.25 ); // Add a double edge
+        auto network_sorted = network;
+        network_sorted.sort_rows();
+        REQUIRE( network_sorted.rows_sorted() );
+
+        for( auto * net : { &network, &network_sorted } )
+        {
+            for( size_t i_agent = 0; i_agent < n_agents; i_agent++ )
+            {
+                auto neighbours = net->get_neighbours( i_agent );
+                auto weights    = net->get_weights( i_agent );
+                for( size_t j_agent = 0; j_agent < n_agents; j_agent++ )
+                {
+                    // The network stores incoming edges, so the row of i_agent holds the edges j_agent -> i_agent
+                    auto it = std::find( neighbours.begin(), neighbours.end(), j_agent );
+                    REQUIRE( net->has_edge( j_agent, i_agent ) == ( it != neighbours.end() ) );
+                    if( it != neighbours.end() )
+                    {
+                        REQUIRE( net->edge_weight( j_agent, i_agent ) == weights[it - neighbours.begin()] );
+                    }
+                    else
+                    {
+                        REQUIRE_FALSE( net->edge_weight( j_agent, i_agent ).has_value() );
+                    }
+                }
+            }
+        }
+
+        // Toggling leaves the rows sorted and swaps the roles of the arguments
+        network.toggle_incoming_outgoing();
+        REQUIRE( network.rows_sorted() );
+        REQUIRE( network.has_edge( 2, 5 ) );
+        REQUIRE( network.edge_weight( 0, 3 ) == 0.5 ); // Agent 3 has the incoming neighbours 0 and 10
+
+        // Adding an edge out of order unsorts the rows
+        network.push_back_neighbour_and_weight( 3, 0, 1.0 );
+        REQUIRE_FALSE( network.rows_sorted() );
+        REQUIRE( network.has_edge( 3, 0 ) );
+        network.remove_double_counting();
+        REQUIRE( network.rows_sorted() );
+    }
+
+    SECTION( "Checking that the memory usage reports the stored edges" )
+    {
+        auto find_entry = []( const MemoryUsage & usage, const std::string & name )
+        {
+            return *std::find_if(
+                usage.entries.begin(), usage.entries.end(), [&]( const auto & entry ) { return entry.name == name; } );
+        };
+
+        auto usage = network.memory_usage();
+        REQUIRE( find_entry( usage, "agents" ).bytes_used == n_agents * sizeof( double ) );
+        REQUIRE(
+            find_entry( usage, "edges.neighbour_list" ).bytes_used
+            == n_agents * sizeof( std::vector<Network::IndexT> ) + network.n_edges() * sizeof( Network::IndexT ) );
+
+        network.set_storage( Network::StorageType::CSR );
+        usage = network.memory_usage();
+        REQUIRE(
+            find_entry( usage, "edges.csr_neighbours" ).bytes_used == network.n_edges() * sizeof( Network::IndexT ) );
+        REQUIRE(
+            find_entry( usage, "edges.csr_weights" ).bytes_used == network.n_edges() * sizeof( Network::WeightT ) );
+        REQUIRE( usage.total_allocated() >= usage.total_used() );
+    }
+
+    SECTION( "Checking that relabeling the agents moves their edges along" )
+    {
+        std::iota( network.agents.begin(), network.agents.end(), 0.0 ); // Mark every agent with its index
+        network.set_dual_direction( true );
+        auto network_permuted = network;
+
+        std::vector<size_t> new_order( n_agents );
+        std::iota( new_order.begin(), new_order.end(), 0 );
+        std::shuffle( new_order.begin(), new_order.end(), gen );
+        network_permuted.permute_agents( new_order );
+
+        for( size_t i_agent = 0; i_agent < n_agents; i_agent++ )
+        {
+            const auto i_original = network_permuted.original_index( i_agent );
+            REQUIRE( i_original == new_order[i_agent] );
+            REQUIRE( network_permuted.agent_index( i_original ) == i_agent );
+            REQUIRE( network_permuted.agents[i_agent] == double( i_original ) );
+
+            for( auto direction : { Network::EdgeDirection::Incoming, Network::EdgeDirection::Outgoing } )
+            {
+                std::vector<size_t> neighbours_original{};
+                for( const auto & neighbour : network_permuted.get_neighbours( i_agent, direction ) )
+                {
+                    neighbours_original.push_back( network_permuted.original_index( neighbour ) );
+                }
+                REQUIRE_THAT(
+                    neighbours_original,
+                    Catch::Matchers::RangeEquals( network.get_neighbours( i_original, direction ) ) );
+                REQUIRE_THAT(
+                    network_permuted.get_weights( i_agent, direction ),
+                    Catch::Matchers::RangeEquals( network.get_weights( i_original, direction ) ) );
+            }
+        }
+
+        // A second relabeling keeps track of the original indices
+        network_permuted.permute_agents( NetworkReordering::reverse_cuthill_mckee( network_permuted ) );
+        for( size_t i_agent = 0; i_agent < n_agents; i_agent++ )
+        {
+            const auto i_original = network_permuted.original_index( i_agent );
+            REQUIRE( network_permuted.agents[i_agent] == double( i_original ) );
+            REQUIRE( network_permuted.n_edges( i_agent ) == network.n_edges( i_original ) );
+        }
+
+        REQUIRE_THROWS( network_permuted.permute_agents( std::vector<size_t>( n_agents, 0 ) ) );
+    }
+
+    SECTION( "Checking that the reverse Cuthill-McKee ordering reduces the bandwidth of a shuffled lattice" )
+    {
+        auto network_lattice = NetworkGeneration::generate_square_lattice<double>( 20 );
+
+        auto bandwidth = [&]()
+        {
+            size_t result = 0;
+            for( size_t i_agent = 0; i_agent < network_lattice.n_agents(); i_agent++ )
+            {
+                for( const auto & neighbour : network_lattice.get_neighbours( i_agent ) )
+                {
+                    result = std::max( result, neighbour > i_agent ? neighbour - i_agent : i_agent - neighbour );
+                }
+            }
+            return result;
+        };
+
+        std::vector<size_t> all_agents( network_lattice.n_agents() );
+        std::iota( all_agents.begin(), all_agents.end(), 0 );
+        auto shuffled = all_agents;
+        std::shuffle( shuffled.begin(), shuffled.end(), gen );
+        network_lattice.permute_agents( shuffled );
+        const auto bandwidth_shuffled = bandwidth();
+
+        for( const auto & new_order :
+             { NetworkReordering::breadth_first_order( network_lattice ),
+               NetworkReordering::reverse_cuthill_mckee( network_lattice ),
+               NetworkReordering::degree_order( network_lattice ) } )
+        {
+            auto sorted_order = new_order;
+            std::sort( sorted_order.begin(), sorted_order.end() );
+            REQUIRE_THAT( sorted_order, Catch::Matchers::RangeEquals( all_agents ) );
+        }
+
+        network_lattice.permute_agents( NetworkReordering::reverse_cuthill_mckee( network_lattice ) );
+        REQUIRE( bandwidth() < bandwidth_shuffled / 2 );
     }
 
     SECTION( "Test the generation of a square lattice neighbour list for three agents" )
@@ -194,6 +726,14 @@ TEST_CASE( "Testing the network class" )
         {
             auto neighbours = network.get_neighbours( i_agent );
             REQUIRE_THAT( neighbours, Catch::Matchers::UnorderedRangeEquals( desired_neighbour_list[i_agent] ) );
+
+            // The lattice neighbours can also be computed without the network
+            for( size_t idx_neighbour = 0; idx_neighbour < neighbours.size(); idx_neighbour++ )
+            {
+                REQUIRE(
+                    neighbours[idx_neighbour]
+                    == Seldon::NetworkGeneration::square_lattice_neighbour( i_agent, idx_neighbour, 3 ) );
+            }
         }
     }
 }
\ No newline at end of file
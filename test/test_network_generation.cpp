@@ -1,10 +1,18 @@
 #include "network.hpp"
 #include "network_generation.hpp"
+#include "util/parallel.hpp"
+#include "util/rng.hpp"
+#include <fmt/format.h>
+#include <algorithm>
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
 #include <catch2/matchers/catch_matchers_range_equals.hpp>
+#include <cmath>
 #include <cstddef>
+#include <numeric>
 #include <random>
 #include <set>
+#include <tuple>
 
 TEST_CASE( "Testing the network generation functions" )
 {
@@ -24,7 +32,7 @@ TEST_CASE( "Testing the network generation functions" )
         {
             WeightT weight = 0.25;
             std::vector<WeightT> weights{ weight, weight, weight }; // Weights to set to
-            auto network = NetworkGeneration::generate_fully_connected<double>( n_agents, weight );
+            const auto network = NetworkGeneration::generate_fully_connected<double>( n_agents, weight );
             // Make sure that the network has been generated correctly
             REQUIRE( network.n_agents() == n_agents ); // There should be n_agents in the new network
 
@@ -38,4 +46,598 @@ TEST_CASE( "Testing the network generation functions" )
             }
         }
     }
+}
+
+TEST_CASE( "Testing the parallel network generation", "[network_generation]" )
+{
+    using namespace Seldon;
+    using Network = Network<double>;
+
+    const size_t n_agents      = 20000;
+    const size_t n_connections = 10;
+    const auto streams         = RNGStreams( 42 );
+
+    SECTION( "generate_n_connections draws unique neighbours with normalized weights" )
+    {
+        auto network = NetworkGeneration::generate_n_connections<double>( n_agents, n_connections, true, streams );
+        REQUIRE( network.n_agents() == n_agents );
+
+        for( size_t i = 0; i < n_agents; ++i )
+        {
+            auto neighbours = network.get_neighbours( i );
+            auto weights    = network.get_weights( i );
+            REQUIRE( neighbours.size() == n_connections + 1 );
+
+            // The self-interaction is the last entry, all other neighbours are unique and not the agent itself
+            REQUIRE( neighbours.back() == i );
+            std::set<size_t> unique_neighbours( neighbours.begin(), neighbours.end() - 1 );
+            REQUIRE( unique_neighbours.size() == n_connections );
+            REQUIRE( !unique_neighbours.contains( i ) );
+
+            double sum_weights = 0.0;
+            for( auto w : weights )
+            {
+                sum_weights += w;
+            }
+            REQUIRE_THAT( sum_weights, Catch::Matchers::WithinRel( 1.0, 1e-12 ) );
+        }
+    }
+
+    SECTION( "The generated networks do not depend on the number of threads" )
+    {
+        auto reference_n_connections
+            = NetworkGeneration::generate_n_connections<double>( n_agents, n_connections, true, streams );
+        auto reference_fully_connected = NetworkGeneration::generate_fully_connected<double>( 300, streams );
+
+        for( size_t n_threads : { 1, 3, 8 } )
+        {
+            Parallel::set_n_threads( n_threads );
+            auto network = NetworkGeneration::generate_n_connections<double>( n_agents, n_connections, true, streams );
+            auto network_fully_connected = NetworkGeneration::generate_fully_connected<double>( 300, streams );
+
+            for( size_t i = 0; i < n_agents; ++i )
+            {
+                REQUIRE_THAT(
+                    network.get_neighbours( i ),
+                    Catch::Matchers::RangeEquals( reference_n_connections.get_neighbours( i ) ) );
+                REQUIRE_THAT(
+                    network.get_weights( i ),
+                    Catch::Matchers::RangeEquals( reference_n_connections.get_weights( i ) ) );
+            }
+            for( size_t i = 0; i < 300; ++i )
+            {
+                REQUIRE_THAT(
+                    network_fully_connected.get_weights( i ),
+                    Catch::Matchers::RangeEquals( reference_fully_connected.get_weights( i ) ) );
+            }
+        }
+        Parallel::set_n_threads( 0 );
+
+        // A different seed gives a different network
+        auto other
+            = NetworkGeneration::generate_n_connections<double>( n_agents, n_connections, true, RNGStreams( 43 ) );
+        size_t n_different = 0;
+        for( size_t i = 0; i < n_agents; ++i )
+        {
+            n_different += ( other.get_neighbours( i )[0] != reference_n_connections.get_neighbours( i )[0] );
+        }
+        REQUIRE( n_different > n_agents / 2 );
+    }
+}
+
+TEST_CASE( "Testing the CSR builder of the network generation", "[network_generation]" )
+{
+    using namespace Seldon;
+    using Network = Network<double>;
+
+    SECTION( "The rows are written directly into the CSR arrays" )
+    {
+        auto builder = NetworkGeneration::CSRBuilder<Network>( 4 );
+        for( size_t i = 0; i < 4; i++ )
+        {
+            builder.set_n_neighbours( i, i );
+        }
+        builder.allocate();
+        for( size_t i = 0; i < 4; i++ )
+        {
+            REQUIRE( builder.n_neighbours( i ) == i );
+            auto neighbours = builder.neighbours( i );
+            auto weights    = builder.weights( i );
+            for( size_t j = 0; j < i; j++ )
+            {
+                neighbours[j] = j;
+                weights[j]    = 0.5 * double( j );
+            }
+        }
+        auto network = builder.build();
+
+        REQUIRE( network.storage() == Network::StorageType::CSR );
+        REQUIRE( network.n_agents() == 4 );
+        REQUIRE( network.n_edges() == 6 );
+        std::vector<size_t> neighbours_expected{ 0, 1, 2 };
+        std::vector<double> weights_expected{ 0.0, 0.5, 1.0 };
+        REQUIRE_THAT( network.get_neighbours( 3 ), Catch::Matchers::RangeEquals( neighbours_expected ) );
+        REQUIRE_THAT( network.get_weights( 3 ), Catch::Matchers::RangeEquals( weights_expected ) );
+        REQUIRE( network.get_neighbours( 0 ).empty() );
+    }
+
+    SECTION( "Unweighted networks have the same neighbours as weighted ones" )
+    {
+        std::mt19937 gen_weighted( 7 );
+        std::mt19937 gen_unweighted( 7 );
+        auto network = NetworkGeneration::generate_n_connections<double>( 200, 5, true, gen_weighted );
+        auto network_unweighted
+            = NetworkGeneration::generate_n_connections<double, Unweighted>( 200, 5, true, gen_unweighted );
+
+        REQUIRE( network.storage() == Network::StorageType::CSR );
+        for( size_t i = 0; i < 200; i++ )
+        {
+            REQUIRE_THAT(
+                network_unweighted.get_neighbours( i ),
+                Catch::Matchers::RangeEquals( network.get_neighbours( i ) ) );
+        }
+
+        // With fewer agents than connections, every other agent is a neighbour
+        auto network_small = NetworkGeneration::generate_n_connections<double>( 3, 5, false, gen_weighted );
+        REQUIRE( network_small.n_edges() == 6 );
+    }
+}
+
+TEST_CASE( "Testing the Erdos-Renyi network generation", "[network_generation]" )
+{
+    using namespace Seldon;
+    using Network = Network<double>;
+
+    const auto streams = RNGStreams( 17 );
+
+    SECTION( "The number of edges follows the binomial distribution" )
+    {
+        const size_t n_agents = 20000;
+        const double p        = 5e-4;
+        auto network          = NetworkGeneration::generate_erdos_renyi<double>( n_agents, p, true, streams );
+
+        REQUIRE( network.storage() == Network::StorageType::CSR );
+        const double n_pairs = double( n_agents ) * double( n_agents - 1 );
+        const double mean    = n_pairs * p;
+        const double sigma   = std::sqrt( mean * ( 1.0 - p ) );
+        REQUIRE_THAT( double( network.n_edges() - n_agents ), Catch::Matchers::WithinAbs( mean, 5 * sigma ) );
+
+        for( size_t i = 0; i < n_agents; ++i )
+        {
+            auto neighbours = network.get_neighbours( i );
+            auto weights    = network.get_weights( i );
+
+            // Sorted, unique neighbours without the agent itself, followed by the self-interaction
+            REQUIRE( neighbours.back() == i );
+            for( size_t j = 0; j + 1 < neighbours.size(); ++j )
+            {
+                REQUIRE( neighbours[j] != i );
+                REQUIRE( ( j == 0 || neighbours[j - 1] < neighbours[j] ) );
+            }
+
+            double sum_weights = 0.0;
+            for( auto w : weights )
+            {
+                sum_weights += w;
+            }
+            REQUIRE_THAT( sum_weights, Catch::Matchers::WithinRel( 1.0, 1e-12 ) );
+        }
+    }
+
+    SECTION( "Every pair of agents is connected with probability p" )
+    {
+        const size_t n_agents = 50;
+        const double p        = 0.3;
+        const size_t n_runs   = 400;
+        std::vector<size_t> histogram( n_agents * n_agents, 0 );
+        for( size_t run = 0; run < n_runs; run++ )
+        {
+            auto network = NetworkGeneration::generate_erdos_renyi<double, Unweighted>(
+                n_agents, p, false, RNGStreams( run ) );
+            for( size_t i = 0; i < n_agents; ++i )
+            {
+                for( auto j : network.get_neighbours( i ) )
+                {
+                    histogram[i * n_agents + j]++;
+                }
+            }
+        }
+
+        const double mean  = double( n_runs ) * p;
+        const double sigma = std::sqrt( mean * ( 1.0 - p ) );
+        for( size_t i = 0; i < n_agents; ++i )
+        {
+            for( size_t j = 0; j < n_agents; ++j )
+            {
+                INFO( fmt::format( "i = {}, j = {}", i, j ) );
+                if( i == j )
+                {
+                    REQUIRE( histogram[i * n_agents + j] == 0 );
+                }
+                else
+                {
+                    REQUIRE_THAT(
+                        double( histogram[i * n_agents + j] ), Catch::Matchers::WithinAbs( mean, 6 * sigma ) );
+                }
+            }
+        }
+    }
+
+    SECTION( "The limiting cases and the independence of the number of threads" )
+    {
+        REQUIRE( NetworkGeneration::generate_erdos_renyi<double>( 100, 0.0, false, streams ).n_edges() == 0 );
+        REQUIRE( NetworkGeneration::generate_erdos_renyi<double>( 100, 1.0, false, streams ).n_edges() == 100 * 99 );
+        REQUIRE( NetworkGeneration::generate_erdos_renyi<double>( 100, 1.0, true, streams ).n_edges() == 100 * 100 );
+
+        auto reference = NetworkGeneration::generate_erdos_renyi<double>( 10000, 1e-3, true, streams );
+        for( size_t n_threads : { 1, 4 } )
+        {
+            Parallel::set_n_threads( n_threads );
+            auto network = NetworkGeneration::generate_erdos_renyi<double>( 10000, 1e-3, true, streams );
+            for( size_t i = 0; i < network.n_agents(); ++i )
+            {
+                REQUIRE_THAT(
+                    network.get_neighbours( i ), Catch::Matchers::RangeEquals( reference.get_neighbours( i ) ) );
+                REQUIRE_THAT( network.get_weights( i ), Catch::Matchers::RangeEquals( reference.get_weights( i ) ) );
+            }
+        }
+        Parallel::set_n_threads( 0 );
+    }
+}
+
+TEST_CASE( "Testing the Barabasi-Albert network generation", "[network_generation]" )
+{
+    using namespace Seldon;
+    using Network = Network<double>;
+
+    std::mt19937 gen( 31 );
+    const size_t n_agents      = 100000;
+    const size_t n_connections = 3;
+    auto network = NetworkGeneration::generate_barabasi_albert<double>( n_agents, n_connections, true, gen );
+
+    SECTION( "The network is undirected and has n_connections edges per added agent" )
+    {
+        REQUIRE( network.storage() == Network::StorageType::CSR );
+        const size_t n_edges_undirected
+            = n_connections * ( n_connections + 1 ) / 2 + ( n_agents - n_connections - 1 ) * n_connections;
+        REQUIRE( network.n_edges() == 2 * n_edges_undirected + n_agents );
+
+        for( size_t i = 0; i < n_agents; ++i )
+        {
+            auto neighbours = network.get_neighbours( i );
+            REQUIRE( neighbours.size() >= n_connections + 1 );
+            REQUIRE( neighbours.back() == i );
+
+            // Sorted, unique neighbours without the agent itself, and every edge is stored in both directions
+            for( size_t j = 0; j + 1 < neighbours.size(); ++j )
+            {
+                REQUIRE( neighbours[j] != i );
+                REQUIRE( ( j == 0 || neighbours[j - 1] < neighbours[j] ) );
+                REQUIRE( network.has_edge( neighbours[j], i ) );
+            }
+
+            double sum_weights = 0.0;
+            for( auto w : network.get_weights( i ) )
+            {
+                sum_weights += w;
+            }
+            REQUIRE_THAT( sum_weights, Catch::Matchers::WithinRel( 1.0, 1e-12 ) );
+        }
+    }
+
+    SECTION( "The degrees follow the distribution of the Barabasi-Albert model" )
+    {
+        // P(k) = 2m(m+1) / (k(k+1)(k+2)), so a fraction 2/(m+2) of the agents keeps the minimal degree m
+        size_t n_minimal_degree = 0;
+        size_t max_degree       = 0;
+        for( size_t i = 0; i < n_agents; ++i )
+        {
+            const size_t degree = network.n_edges( i ) - 1;
+            n_minimal_degree += ( degree == n_connections );
+            max_degree = std::max( max_degree, degree );
+        }
+        REQUIRE_THAT(
+            double( n_minimal_degree ) / double( n_agents ),
+            Catch::Matchers::WithinAbs( 2.0 / double( n_connections + 2 ), 0.02 ) );
+        // The largest hub grows like sqrt(n_agents)
+        REQUIRE( max_degree > 100 );
+    }
+
+    SECTION( "Too few agents" )
+    {
+        REQUIRE_THROWS( NetworkGeneration::generate_barabasi_albert<double>( 3, 3, false, gen ) );
+        auto network_seed = NetworkGeneration::generate_barabasi_albert<double, Unweighted>( 4, 3, false, gen );
+        REQUIRE( network_seed.n_edges() == 12 );
+    }
+}
+
+TEST_CASE( "Testing the small-world network generation", "[network_generation]" )
+{
+    using namespace Seldon;
+    using Network = Network<double>;
+
+    const auto streams = RNGStreams( 5 );
+
+    SECTION( "The ring lattice" )
+    {
+        auto ring = NetworkGeneration::generate_ring_lattice<double>( 10, 2, 0.25 );
+        REQUIRE( ring.storage() == Network::StorageType::CSR );
+        REQUIRE( ring.n_edges() == 40 );
+        std::vector<size_t> neighbours_expected{ 9, 1, 8, 2 };
+        std::vector<double> weights_expected{ 0.25, 0.25, 0.25, 0.25 };
+        REQUIRE_THAT( ring.get_neighbours( 0 ), Catch::Matchers::RangeEquals( neighbours_expected ) );
+        REQUIRE_THAT( ring.get_weights( 0 ), Catch::Matchers::RangeEquals( weights_expected ) );
+        REQUIRE_THROWS( NetworkGeneration::generate_ring_lattice<double>( 4, 2 ) );
+    }
+
+    SECTION( "A fraction p of the edges is rewired, without duplicates" )
+    {
+        const size_t n_agents              = 10000;
+        const size_t n_neighbours_per_side = 3;
+        const double p                     = 0.2;
+        auto network
+            = NetworkGeneration::generate_watts_strogatz<double>( n_agents, n_neighbours_per_side, p, streams, 0.5 );
+
+        size_t n_rewired = 0;
+        for( size_t i = 0; i < n_agents; ++i )
+        {
+            auto neighbours = network.get_neighbours( i );
+            REQUIRE( neighbours.size() == 2 * n_neighbours_per_side );
+            REQUIRE( std::ranges::is_sorted( neighbours ) );
+            REQUIRE( std::adjacent_find( neighbours.begin(), neighbours.end() ) == neighbours.end() );
+            for( auto j : neighbours )
+            {
+                REQUIRE( j != i );
+                const size_t distance = std::min( ( j + n_agents - i ) % n_agents, ( i + n_agents - j ) % n_agents );
+                n_rewired += ( distance > n_neighbours_per_side );
+            }
+            for( auto w : network.get_weights( i ) )
+            {
+                REQUIRE( w == 0.5 );
+            }
+        }
+
+        // A rewired edge never lands on a current neighbour, so it can only be recognized by the distance
+        const double n_edges = double( network.n_edges() );
+        const double mean    = n_edges * p;
+        const double sigma   = std::sqrt( n_edges * p * ( 1.0 - p ) );
+        REQUIRE_THAT( double( n_rewired ), Catch::Matchers::WithinAbs( mean, 5 * sigma ) );
+    }
+
+    SECTION( "Rewiring the square lattice and the limiting cases" )
+    {
+        auto lattice = NetworkGeneration::generate_square_lattice<double>( 20, 0.25 );
+        auto rewired = lattice;
+        NetworkGeneration::rewire_edges( rewired, 0.0, streams );
+        for( size_t i = 0; i < lattice.n_agents(); ++i )
+        {
+            REQUIRE_THAT(
+                rewired.get_neighbours( i ), Catch::Matchers::UnorderedRangeEquals( lattice.get_neighbours( i ) ) );
+        }
+
+        NetworkGeneration::rewire_edges( rewired, 1.0, streams );
+        for( size_t i = 0; i < lattice.n_agents(); ++i )
+        {
+            REQUIRE( rewired.n_edges( i ) == 4 );
+        }
+
+        // Self-interactions are kept, agents that are connected to all others are left alone
+        std::mt19937 gen( 1 );
+        auto network = NetworkGeneration::generate_n_connections<double>( 50, 3, true, gen );
+        NetworkGeneration::rewire_edges( network, 1.0, streams );
+        for( size_t i = 0; i < network.n_agents(); ++i )
+        {
+            REQUIRE( network.has_edge( i, i ) );
+            REQUIRE( network.n_edges( i ) == 4 );
+        }
+        auto network_complete = NetworkGeneration::generate_n_connections<double>( 5, 4, true, gen );
+        auto network_complete_rewired = network_complete;
+        NetworkGeneration::rewire_edges( network_complete_rewired, 1.0, streams );
+        REQUIRE_THAT(
+            network_complete_rewired.get_neighbours( 2 ),
+            Catch::Matchers::UnorderedRangeEquals( network_complete.get_neighbours( 2 ) ) );
+    }
+
+    SECTION( "The rewiring does not depend on the number of threads" )
+    {
+        auto reference = NetworkGeneration::generate_watts_strogatz<double>( 20000, 2, 0.1, streams );
+        for( size_t n_threads : { 1, 3 } )
+        {
+            Parallel::set_n_threads( n_threads );
+            auto network = NetworkGeneration::generate_watts_strogatz<double>( 20000, 2, 0.1, streams );
+            for( size_t i = 0; i < network.n_agents(); ++i )
+            {
+                REQUIRE_THAT(
+                    network.get_neighbours( i ), Catch::Matchers::RangeEquals( reference.get_neighbours( i ) ) );
+            }
+        }
+        Parallel::set_n_threads( 0 );
+    }
+}
+
+TEST_CASE( "Testing the stochastic block model generation", "[network_generation]" )
+{
+    using namespace Seldon;
+    using Network = Network<double>;
+
+    const auto streams = RNGStreams( 11 );
+    const std::vector<size_t> block_sizes{ 3000, 500, 1500 };
+    const std::vector<std::vector<double>> probabilities{
+        { 2e-3, 1e-2, 0.0 }, { 1e-3, 0.05, 2e-4 }, { 0.0, 1e-2, 4e-3 }
+    };
+
+    auto block_of = [&]( size_t idx_agent )
+    {
+        size_t idx_block = 0;
+        while( idx_agent >= block_sizes[idx_block] )
+        {
+            idx_agent -= block_sizes[idx_block++];
+        }
+        return idx_block;
+    };
+
+    SECTION( "The number of edges between every pair of blocks follows the binomial distribution" )
+    {
+        auto network = NetworkGeneration::generate_stochastic_block_model<double>(
+            block_sizes, probabilities, true, streams );
+        REQUIRE( network.storage() == Network::StorageType::CSR );
+        REQUIRE( network.n_agents() == 5000 );
+
+        std::vector<std::vector<size_t>> n_edges( 3, std::vector<size_t>( 3, 0 ) );
+        for( size_t i = 0; i < network.n_agents(); ++i )
+        {
+            auto neighbours = network.get_neighbours( i );
+            REQUIRE( neighbours.back() == i );
+            for( size_t j = 0; j + 1 < neighbours.size(); ++j )
+            {
+                REQUIRE( neighbours[j] != i );
+                REQUIRE( ( j == 0 || neighbours[j - 1] < neighbours[j] ) );
+                n_edges[block_of( i )][block_of( neighbours[j] )]++;
+            }
+
+            double sum_weights = 0.0;
+            for( auto w : network.get_weights( i ) )
+            {
+                sum_weights += w;
+            }
+            REQUIRE_THAT( sum_weights, Catch::Matchers::WithinRel( 1.0, 1e-12 ) );
+        }
+
+        for( size_t a = 0; a < 3; a++ )
+        {
+            for( size_t b = 0; b < 3; b++ )
+            {
+                INFO( fmt::format( "a = {}, b = {}", a, b ) );
+                const double n_pairs = double( block_sizes[a] ) * double( block_sizes[b] - ( a == b ? 1 : 0 ) );
+                const double mean    = n_pairs * probabilities[a][b];
+                const double sigma   = std::sqrt( mean * ( 1.0 - probabilities[a][b] ) );
+                REQUIRE_THAT( double( n_edges[a][b] ), Catch::Matchers::WithinAbs( mean, 5 * sigma ) );
+            }
+        }
+    }
+
+    SECTION( "The network does not depend on the number of threads" )
+    {
+        auto reference = NetworkGeneration::generate_stochastic_block_model<double>(
+            block_sizes, probabilities, false, streams );
+        Parallel::set_n_threads( 4 );
+        auto network = NetworkGeneration::generate_stochastic_block_model<double>(
+            block_sizes, probabilities, false, streams );
+        Parallel::set_n_threads( 0 );
+        for( size_t i = 0; i < network.n_agents(); ++i )
+        {
+            REQUIRE_THAT( network.get_neighbours( i ), Catch::Matchers::RangeEquals( reference.get_neighbours( i ) ) );
+            REQUIRE_THAT( network.get_weights( i ), Catch::Matchers::RangeEquals( reference.get_weights( i ) ) );
+        }
+    }
+
+    SECTION( "Invalid probabilities" )
+    {
+        REQUIRE_THROWS( NetworkGeneration::generate_stochastic_block_model<double>(
+            { 10, 10 }, { { 0.1, 0.1 } }, false, streams ) );
+        REQUIRE_THROWS( NetworkGeneration::generate_stochastic_block_model<double>(
+            { 10, 10 }, { { 0.1, 0.1 }, { 1.5, 0.1 } }, false, streams ) );
+    }
+}
+
+TEST_CASE( "Testing the d-dimensional lattices", "[network_generation]" )
+{
+    using namespace Seldon;
+    using Stencil       = NetworkGeneration::LatticeStencil;
+    using Neighbourhood = Stencil::Neighbourhood;
+
+    SECTION( "The square lattice and the ring are special cases of the stencil" )
+    {
+        auto square = Stencil( { 5, 5 }, Neighbourhood::VonNeumann, 1 );
+        REQUIRE( square.n_sites() == 25 );
+        REQUIRE( square.n_neighbours() == 4 );
+        for( size_t idx_site = 0; idx_site < 25; idx_site++ )
+        {
+            for( size_t idx_neighbour = 0; idx_neighbour < 4; idx_neighbour++ )
+            {
+                REQUIRE(
+                    square.neighbour( idx_site, idx_neighbour )
+                    == NetworkGeneration::square_lattice_neighbour( idx_site, idx_neighbour, 5 ) );
+            }
+        }
+
+        auto ring = Stencil( { 10 }, Neighbourhood::VonNeumann, 2 );
+        std::vector<size_t> neighbours_expected{ 9, 1, 8, 2 };
+        std::vector<size_t> neighbours{};
+        for( size_t idx_neighbour = 0; idx_neighbour < ring.n_neighbours(); idx_neighbour++ )
+        {
+            neighbours.push_back( ring.neighbour( 0, idx_neighbour ) );
+        }
+        REQUIRE( neighbours == neighbours_expected );
+
+        REQUIRE_THROWS( Stencil( {}, Neighbourhood::Moore, 1 ) );
+        REQUIRE_THROWS( Stencil( { 4, 0 }, Neighbourhood::Moore, 1 ) );
+
+        // Every extent has to fit the neighbourhood, without coinciding neighbours
+        REQUIRE_NOTHROW( Stencil( { 3, 5 }, Neighbourhood::Moore, 1 ) );
+        REQUIRE_THROWS( Stencil( { 2, 5 }, Neighbourhood::Moore, 1 ) );
+        REQUIRE_THROWS( Stencil( { 9, 4 }, Neighbourhood::VonNeumann, 2 ) );
+        REQUIRE_THROWS( NetworkGeneration::generate_square_lattice<double>( 2 ) );
+    }
+
+    SECTION( "The neighbourhoods contain all sites within the radius" )
+    {
+        // (extents, neighbourhood, radius, number of neighbours)
+        const std::vector<std::tuple<std::vector<size_t>, Neighbourhood, size_t, size_t>> cases{
+            { { 7, 6, 5 }, Neighbourhood::VonNeumann, 1, 6 },
+            { { 7, 6, 5 }, Neighbourhood::Moore, 1, 26 },
+            { { 9, 11 }, Neighbourhood::VonNeumann, 2, 12 },
+            { { 9, 11 }, Neighbourhood::Moore, 2, 24 },
+            { { 13 }, Neighbourhood::Moore, 3, 6 },
+        };
+
+        for( const auto & [extents, neighbourhood, radius, n_neighbours] : cases )
+        {
+            auto stencil = Stencil( extents, neighbourhood, radius );
+            auto network = NetworkGeneration::generate_lattice<double>( stencil, 0.5 );
+            REQUIRE( stencil.n_neighbours() == n_neighbours );
+            REQUIRE( network.n_agents() == stencil.n_sites() );
+            REQUIRE( network.n_edges() == stencil.n_sites() * n_neighbours );
+
+            // The periodic distance along every dimension, between two sites
+            auto distances = [&]( size_t idx_site_1, size_t idx_site_2 )
+            {
+                std::vector<size_t> result{};
+                for( auto extent : extents )
+                {
+                    const size_t x1 = idx_site_1 % extent;
+                    const size_t x2 = idx_site_2 % extent;
+                    result.push_back( std::min( ( x1 + extent - x2 ) % extent, ( x2 + extent - x1 ) % extent ) );
+                    idx_site_1 /= extent;
+                    idx_site_2 /= extent;
+                }
+                return result;
+            };
+
+            for( size_t idx_site = 0; idx_site < stencil.n_sites(); idx_site++ )
+            {
+                auto neighbours = network.get_neighbours( idx_site );
+                std::set<size_t> unique_neighbours( neighbours.begin(), neighbours.end() );
+                REQUIRE( unique_neighbours.size() == n_neighbours );
+                REQUIRE( !unique_neighbours.contains( idx_site ) );
+
+                for( size_t idx_neighbour = 0; idx_neighbour < n_neighbours; idx_neighbour++ )
+                {
+                    const size_t j = neighbours[idx_neighbour];
+                    REQUIRE( j == stencil.neighbour( idx_site, idx_neighbour ) );
+                    REQUIRE( network.has_edge( j, idx_site ) );
+
+                    auto d = distances( idx_site, j );
+                    if( neighbourhood == Neighbourhood::VonNeumann )
+                    {
+                        REQUIRE( std::accumulate( d.begin(), d.end(), size_t( 0 ) ) <= radius );
+                    }
+                    else
+                    {
+                        REQUIRE( std::ranges::max( d ) <= radius );
+                    }
+                }
+            }
+        }
+    }
 }
\ No newline at end of file
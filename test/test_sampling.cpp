@@ -1,11 +1,16 @@
 #include "util/math.hpp"
 #include <fmt/format.h>
 #include <algorithm>
+#include <array>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <random>
 #include <set>
+#include <span>
+#include <utility>
 #include <vector>
 
 double compute_p( size_t k, size_t n )
@@ -86,6 +91,57 @@ TEST_CASE( "Testing sampling functions" )
                 "Many deviations beyond the 3 sigma range. {} out of {}", number_outside_three_sigma, N_RUNS ) );
     }
 
+    SECTION( "draw_unique_k_from_n_algorithms", "Drawing k numbers out of n, for all sampling algorithms" )
+    {
+        // Selection sampling, Floyd's algorithm with a linear search and with a hash set, more than n, huge n
+        for( const auto & [k, n] : std::vector<std::pair<size_t, size_t>>{
+                 { 100, 1000 }, { 10, 1000 }, { 70, 2000 }, { 12, 10 }, { 10, 1000000 } } )
+        {
+            const size_t ignore_idx = n / 3;
+            const size_t n_runs     = std::min<size_t>( 2000, 100000000 / n );
+            std::vector<size_t> histogram( n, 0 );
+
+            std::vector<uint32_t> buffer{};
+            for( size_t i = 0; i < n_runs; i++ )
+            {
+                Seldon::draw_unique_k_from_n( ignore_idx, k, n, buffer, gen );
+                REQUIRE( buffer.size() == std::min( k, n - 1 ) );
+                REQUIRE( std::adjacent_find( buffer.begin(), buffer.end(), std::greater_equal<>() ) == buffer.end() );
+                REQUIRE( buffer.back() < n );
+                for( const auto & idx : buffer )
+                {
+                    histogram[idx]++;
+                }
+            }
+            REQUIRE( histogram[ignore_idx] == 0 );
+
+            // Every other index is drawn with the same probability (if there are enough runs to tell)
+            const double mean  = double( n_runs ) * double( std::min( k, n - 1 ) ) / double( n - 1 );
+            const double sigma = std::sqrt( mean );
+            for( size_t idx = 0; idx < n && mean > 10; idx++ )
+            {
+                INFO( fmt::format( "k = {}, n = {}, idx = {}", k, n, idx ) );
+                if( idx != ignore_idx )
+                {
+                    REQUIRE_THAT( double( histogram[idx] ), Catch::Matchers::WithinAbs( mean, 5 * sigma ) );
+                }
+            }
+        }
+    }
+
+    SECTION( "draw_unique_from_n_into", "Drawing numbers out of n into an existing buffer" )
+    {
+        // The buffer is filled completely, e.g. a row of the storage of a network
+        std::array<uint32_t, 8> storage{};
+        Seldon::draw_unique_from_n_into( 3, 20, std::span<uint32_t>( storage ), gen );
+        REQUIRE( std::adjacent_find( storage.begin(), storage.end(), std::greater_equal<>() ) == storage.end() );
+        REQUIRE( std::find( storage.begin(), storage.end(), 3u ) == storage.end() );
+        REQUIRE( storage.back() < 20 );
+
+        // Unlike draw_unique_k_from_n, the buffer is not shrunk when there are too few agents
+        REQUIRE_THROWS( Seldon::draw_unique_from_n_into( 3, 8, std::span<uint32_t>( storage ), gen ) );
+    }
+
     SECTION( "weighted_reservior_sampling", "Testing weighted reservoir sampling with A_ExpJ algorithm" )
     {
 
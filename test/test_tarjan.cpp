@@ -4,7 +4,12 @@
 #include "connectivity.hpp"
 #include <fmt/format.h>
 #include <fmt/ranges.h>
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <random>
 #include <set>
+#include <span>
 #include <vector>
 
 // Create the vector of vectors containing the neighbour indices
@@ -50,11 +55,11 @@ TEST_CASE( "Test for Tarjan's algorithm for strongly connected networks", "[tarj
 
     // List of SCC
     // [[5, 4], [3], [2, 1, 0], [9, 8, 7, 6]]
-    INFO( fmt::format( "SCC = {}\n", tarjan_scc.scc_list ) );
+    INFO( fmt::format( "SCC = {}\n", tarjan_scc.components.to_nested() ) );
 
     std::set<std::set<size_t>> expected_scc{ { 5, 4 }, { 3 }, { 2, 1, 0 }, { 9, 8, 7, 6 } };
 
-    for( const auto & scc : tarjan_scc.scc_list )
+    for( const auto & scc : tarjan_scc.components.to_nested() )
     {
         std::set<size_t> temp_set;
         temp_set.insert( scc.begin(), scc.end() );
@@ -62,5 +67,324 @@ TEST_CASE( "Test for Tarjan's algorithm for strongly connected networks", "[tarj
     }
 
     // There should be 4 strongly connected components
-    REQUIRE_THAT( tarjan_scc.scc_list, Catch::Matchers::SizeIs( 4 ) );
-}
\ No newline at end of file
+    REQUIRE( tarjan_scc.components.size() == 4 );
+
+    // The components are stored in one flat array
+    REQUIRE( tarjan_scc.components.vertices.size() == neighbour_list.size() );
+    REQUIRE( tarjan_scc.components.offsets.back() == neighbour_list.size() );
+}
+
+TEST_CASE( "Test Tarjan's algorithm with an edge into a finished vertex of the current component", "[tarjan]" )
+{
+    // 0 -> 1 -> 0 and 0 -> 2 -> 1: vertex 1 is finished before 2 is visited, but 2 still belongs to the component
+    std::vector<std::vector<size_t>> neighbour_list{ { 1, 2 }, { 0 }, { 1 } };
+
+    auto tarjan_scc = Seldon::TarjanConnectivityAlgo( neighbour_list );
+    REQUIRE( tarjan_scc.components.size() == 1 );
+    REQUIRE_THAT( tarjan_scc.components[0], Catch::Matchers::UnorderedRangeEquals( std::vector<size_t>{ 0, 1, 2 } ) );
+}
+
+TEST_CASE( "Test Tarjan's algorithm on long paths", "[tarjan]" )
+{
+    // The depth-first search goes n_vertices deep, which would overflow the call stack of a recursive implementation
+    const size_t n_vertices = 1000000;
+    std::vector<uint32_t> next( n_vertices );
+    std::iota( next.begin(), next.end(), 1 );
+
+    SECTION( "A chain has one component per vertex" )
+    {
+        auto get_neighbours = [&]( size_t v )
+        { return std::span<const uint32_t>( next.data() + v, v + 1 < n_vertices ? 1 : 0 ); };
+        auto tarjan_scc = Seldon::TarjanConnectivityAlgo<uint32_t>( n_vertices, get_neighbours );
+
+        REQUIRE( tarjan_scc.components.size() == n_vertices );
+        // In reverse topological order, the end of the chain is found first
+        REQUIRE( tarjan_scc.components[0][0] == n_vertices - 1 );
+        REQUIRE( tarjan_scc.components[n_vertices - 1][0] == 0 );
+    }
+
+    SECTION( "A cycle is a single component" )
+    {
+        next.back()         = 0;
+        auto get_neighbours = [&]( size_t v ) { return std::span<const uint32_t>( next.data() + v, 1 ); };
+        auto tarjan_scc     = Seldon::TarjanConnectivityAlgo<uint32_t>( n_vertices, get_neighbours );
+
+        REQUIRE( tarjan_scc.components.size() == 1 );
+        REQUIRE( tarjan_scc.components[0].size() == n_vertices );
+    }
+}
+
+TEST_CASE( "Test the parallel algorithm for strongly connected components", "[tarjan]" )
+{
+    auto tarjan_components = []( const std::vector<std::vector<size_t>> & neighbour_list )
+    {
+        auto components = Seldon::TarjanConnectivityAlgo( neighbour_list ).components;
+        components.sort();
+        return components;
+    };
+
+    auto parallel_components = []( const std::vector<std::vector<size_t>> & neighbour_list, size_t n_threads )
+    {
+        auto get_neighbours = [&]( size_t v ) { return std::span<const size_t>( neighbour_list[v] ); };
+        return Seldon::ParallelConnectivityAlgo<size_t>( neighbour_list.size(), get_neighbours, n_threads ).components;
+    };
+
+    std::mt19937 gen( 42 );
+
+    SECTION( "Small example" )
+    {
+        // The example from above
+        // clang-format off
+        std::vector<std::vector<size_t>> neighbour_list{
+            {1}, {2,3}, {0}, {4}, {5}, {4}, {4,7}, {5,8}, {9}, {6,7}
+        };
+        // clang-format on
+        auto components = parallel_components( neighbour_list, 2 );
+        std::vector<std::vector<size_t>> expected{ { 0, 1, 2 }, { 3 }, { 4, 5 }, { 6, 7, 8, 9 } };
+        REQUIRE( components.to_nested() == expected );
+    }
+
+    SECTION( "Random sparse networks" )
+    {
+        // With about one edge per vertex, there is a giant component, many small ones and many trivial ones
+        const size_t n_vertices = 60000;
+        for( const double mean_degree : { 0.9, 1.2, 2.0 } )
+        {
+            std::poisson_distribution<size_t> degree_dist( mean_degree );
+            std::uniform_int_distribution<size_t> vertex_dist( 0, n_vertices - 1 );
+            std::vector<std::vector<size_t>> neighbour_list( n_vertices );
+            for( auto & neighbours : neighbour_list )
+            {
+                neighbours.resize( degree_dist( gen ) );
+                std::generate( neighbours.begin(), neighbours.end(), [&]() { return vertex_dist( gen ); } );
+            }
+
+            const auto expected = tarjan_components( neighbour_list );
+            INFO( fmt::format( "mean_degree = {}, n_components = {}", mean_degree, expected.size() ) );
+            REQUIRE( parallel_components( neighbour_list, 1 ) == expected );
+            REQUIRE( parallel_components( neighbour_list, 4 ) == expected );
+        }
+    }
+
+    SECTION( "Many cycles" )
+    {
+        // Cycles of different lengths, connected in one direction, so that no vertex is trivial
+        std::vector<std::vector<size_t>> neighbour_list{};
+        size_t cycle_length = 1;
+        while( neighbour_list.size() < 50000 )
+        {
+            const size_t first = neighbour_list.size();
+            for( size_t i = 0; i < cycle_length; i++ )
+            {
+                neighbour_list.push_back( { first + ( i + 1 ) % cycle_length } );
+            }
+            if( first > 0 )
+            {
+                neighbour_list[first].push_back( first - 1 );
+            }
+            cycle_length = cycle_length % 7 + 2;
+        }
+
+        // Relabel the vertices randomly, so that the components are not contiguous
+        std::vector<size_t> new_index( neighbour_list.size() );
+        std::iota( new_index.begin(), new_index.end(), 0 );
+        std::shuffle( new_index.begin(), new_index.end(), gen );
+        std::vector<std::vector<size_t>> relabeled_list( neighbour_list.size() );
+        for( size_t v = 0; v < neighbour_list.size(); v++ )
+        {
+            for( const auto & u : neighbour_list[v] )
+            {
+                relabeled_list[new_index[v]].push_back( new_index[u] );
+            }
+        }
+        neighbour_list = std::move( relabeled_list );
+
+        const auto expected = tarjan_components( neighbour_list );
+        REQUIRE( parallel_components( neighbour_list, 1 ) == expected );
+        REQUIRE( parallel_components( neighbour_list, 4 ) == expected );
+    }
+}
+
+TEST_CASE( "Test weakly connected components", "[tarjan]" )
+{
+    SECTION( "Small example" )
+    {
+        // Two chains with opposite directions and an isolated vertex
+        std::vector<std::vector<size_t>> neighbour_list{ { 2 }, {}, { 4 }, { 1 }, {}, { 3 } };
+        auto get_neighbours = [&]( size_t v ) { return std::span<const size_t>( neighbour_list[v] ); };
+        auto wcc            = Seldon::WeakConnectivityAlgo<size_t>( neighbour_list.size(), get_neighbours, 2 );
+
+        std::vector<std::vector<size_t>> expected{ { 0, 2, 4 }, { 1, 3, 5 } };
+        REQUIRE( wcc.components.to_nested() == expected );
+    }
+
+    SECTION( "Random sparse network" )
+    {
+        const size_t n_vertices = 100000;
+        std::mt19937 gen( 7 );
+        std::uniform_int_distribution<size_t> vertex_dist( 0, n_vertices - 1 );
+        std::vector<std::vector<size_t>> neighbour_list( n_vertices );
+        for( size_t i_edge = 0; i_edge < n_vertices / 2; i_edge++ )
+        {
+            neighbour_list[vertex_dist( gen )].push_back( vertex_dist( gen ) );
+        }
+
+        // Breadth-first search on the undirected graph
+        std::vector<std::vector<size_t>> undirected_list = neighbour_list;
+        for( size_t v = 0; v < n_vertices; v++ )
+        {
+            for( const auto & u : neighbour_list[v] )
+            {
+                undirected_list[u].push_back( v );
+            }
+        }
+        std::vector<size_t> root( n_vertices, n_vertices );
+        for( size_t v_start = 0; v_start < n_vertices; v_start++ )
+        {
+            if( root[v_start] != n_vertices )
+            {
+                continue;
+            }
+            root[v_start]             = v_start;
+            std::vector<size_t> stack = { v_start };
+            while( !stack.empty() )
+            {
+                const size_t v = stack.back();
+                stack.pop_back();
+                for( const auto & u : undirected_list[v] )
+                {
+                    if( root[u] == n_vertices )
+                    {
+                        root[u] = v_start;
+                        stack.push_back( u );
+                    }
+                }
+            }
+        }
+        const auto expected = Seldon::ComponentList<size_t>::from_representatives( root );
+
+        auto get_neighbours = [&]( size_t v ) { return std::span<const size_t>( neighbour_list[v] ); };
+        REQUIRE( Seldon::WeakConnectivityAlgo<size_t>( n_vertices, get_neighbours, 1 ).components == expected );
+        REQUIRE( Seldon::WeakConnectivityAlgo<size_t>( n_vertices, get_neighbours, 4 ).components == expected );
+    }
+}
+
+TEST_CASE( "Test the condensation of a network", "[tarjan]" )
+{
+    auto check_condensation = []( const std::vector<std::vector<size_t>> & neighbour_list,
+                                  const Seldon::CondensationDAG<size_t> & dag )
+    {
+        // Every edge of the graph is within a component or an edge of the DAG, in topological order
+        std::set<std::pair<size_t, size_t>> expected_edges{};
+        for( size_t v = 0; v < neighbour_list.size(); v++ )
+        {
+            for( const auto & u : neighbour_list[v] )
+            {
+                REQUIRE( dag.component_of[v] <= dag.component_of[u] );
+                if( dag.component_of[v] != dag.component_of[u] )
+                {
+                    expected_edges.insert( { dag.component_of[v], dag.component_of[u] } );
+                }
+            }
+        }
+
+        std::set<std::pair<size_t, size_t>> dag_edges{};
+        for( size_t idx_component = 0; idx_component < dag.n_components(); idx_component++ )
+        {
+            for( const auto & v : dag.components[idx_component] )
+            {
+                REQUIRE( dag.component_of[v] == idx_component );
+            }
+            for( const auto & target : dag.get_neighbours( idx_component ) )
+            {
+                dag_edges.insert( { idx_component, target } );
+            }
+        }
+        REQUIRE( dag.n_edges() == dag_edges.size() );
+        REQUIRE( dag_edges == expected_edges );
+    };
+
+    SECTION( "Small example" )
+    {
+        // The example from above
+        // clang-format off
+        std::vector<std::vector<size_t>> neighbour_list{
+            {1}, {2,3}, {0}, {4}, {5}, {4}, {4,7}, {5,8}, {9}, {6,7}
+        };
+        // clang-format on
+        auto get_neighbours = [&]( size_t v ) { return std::span<const size_t>( neighbour_list[v] ); };
+        auto scc            = Seldon::TarjanConnectivityAlgo( neighbour_list ).components;
+        auto dag            = Seldon::CondensationDAG<size_t>( scc, get_neighbours );
+
+        REQUIRE( dag.n_components() == 4 );
+        REQUIRE( dag.n_edges() == 3 );
+        // {4, 5} is the only sink
+        REQUIRE( dag.component_of[4] == 3 );
+        check_condensation( neighbour_list, dag );
+    }
+
+    SECTION( "Random sparse network" )
+    {
+        const size_t n_vertices = 60000;
+        std::mt19937 gen( 3 );
+        std::poisson_distribution<size_t> degree_dist( 1.2 );
+        std::uniform_int_distribution<size_t> vertex_dist( 0, n_vertices - 1 );
+        std::vector<std::vector<size_t>> neighbour_list( n_vertices );
+        for( auto & neighbours : neighbour_list )
+        {
+            neighbours.resize( degree_dist( gen ) );
+            std::generate( neighbours.begin(), neighbours.end(), [&]() { return vertex_dist( gen ); } );
+        }
+        auto get_neighbours = [&]( size_t v ) { return std::span<const size_t>( neighbour_list[v] ); };
+        auto scc = Seldon::ParallelConnectivityAlgo<size_t>( n_vertices, get_neighbours, 4 ).components;
+
+        auto dag = Seldon::CondensationDAG<size_t>( scc, get_neighbours, 4 );
+        REQUIRE( dag.n_components() == scc.size() );
+        check_condensation( neighbour_list, dag );
+
+        // The result does not depend on the number of threads
+        REQUIRE( Seldon::CondensationDAG<size_t>( scc, get_neighbours, 1 ).components == dag.components );
+    }
+}
+
+TEST_CASE( "Test the connectivity tracker", "[tarjan]" )
+{
+    const size_t n_vertices = 20000;
+    std::mt19937 gen( 11 );
+    std::uniform_int_distribution<size_t> vertex_dist( 0, n_vertices - 1 );
+    Seldon::ConnectivityTracker<size_t> tracker( n_vertices );
+
+    REQUIRE( tracker.stats().n_components == n_vertices );
+    REQUIRE( tracker.stats().giant_component_size == 1 );
+    REQUIRE( tracker.stats().n_isolated == n_vertices );
+
+    // Rebuild the network a few times, with more and more edges
+    for( const size_t n_edges : { n_vertices / 4, n_vertices / 2, n_vertices } )
+    {
+        tracker.reset( n_vertices );
+        std::vector<std::vector<size_t>> neighbour_list( n_vertices );
+        for( size_t i_edge = 0; i_edge < n_edges; i_edge++ )
+        {
+            const size_t v1 = vertex_dist( gen );
+            const size_t v2 = vertex_dist( gen );
+            neighbour_list[v1].push_back( v2 );
+            tracker.add_edge( v1, v2 );
+        }
+
+        // Compare with the components of the whole network
+        auto get_neighbours = [&]( size_t v ) { return std::span<const size_t>( neighbour_list[v] ); };
+        auto wcc            = Seldon::WeakConnectivityAlgo<size_t>( n_vertices, get_neighbours ).components;
+        size_t giant_component_size = 0;
+        size_t n_isolated           = 0;
+        for( size_t idx_component = 0; idx_component < wcc.size(); idx_component++ )
+        {
+            giant_component_size = std::max( giant_component_size, wcc[idx_component].size() );
+            n_isolated += wcc[idx_component].size() == 1;
+        }
+
+        INFO( fmt::format( "n_edges = {}", n_edges ) );
+        REQUIRE( tracker.stats().n_components == wcc.size() );
+        REQUIRE( tracker.stats().giant_component_size == giant_component_size );
+        REQUIRE( tracker.stats().n_isolated == n_isolated );
+    }
+}
@@ -1,10 +1,15 @@
 #include "catch2/matchers/catch_matchers.hpp"
 #include "util/math.hpp"
+#include "util/memory.hpp"
 #include "util/misc.hpp"
+#include "util/parallel.hpp"
 
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
 #include <catch2/matchers/catch_matchers_range_equals.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
 
 TEST_CASE( "Test parse_comma_separated_list", "[util_parse_list]" )
 {
@@ -34,6 +39,66 @@ TEST_CASE( "Test parse_comma_separated_list", "[util_parse_list]" )
     REQUIRE_THAT( int_vec, Catch::Matchers::RangeEquals( int_vec_expected ) );
 }
 
+TEST_CASE( "Test the allocation-free text parsing helpers", "[util_parse_text]" )
+{
+    SECTION( "Numbers are parsed like std::stod and std::stoi" )
+    {
+        REQUIRE( Seldon::parse_number<double>( "  -2.5  " ) == -2.5 );
+        REQUIRE( Seldon::parse_number<double>( "+1e3," ) == 1000.0 );
+        REQUIRE( Seldon::parse_number<int>( "\t42 " ) == 42 );
+        REQUIRE( Seldon::parse_number<size_t>( "7.9" ) == 7 );
+        REQUIRE_THROWS( Seldon::parse_number<double>( "" ) );
+        REQUIRE_THROWS( Seldon::parse_number<int>( " aa" ) );
+    }
+
+    SECTION( "Columns and lines are views into the text" )
+    {
+        std::vector<std::string_view> columns{};
+        Seldon::for_each_column( " 1, a ,,x", [&]( size_t, std::string_view column ) { columns.push_back( column ); } );
+        REQUIRE( columns == std::vector<std::string_view>{ " 1", " a ", "", "x" } );
+
+        std::vector<std::string_view> lines{};
+        auto add_line = [&]( std::string_view line ) { lines.push_back( line ); };
+        REQUIRE( Seldon::for_each_data_line( "# comment\n1, 2\n3\n", add_line ) );
+        REQUIRE( !Seldon::for_each_data_line( "4\n\n5", add_line ) );
+        REQUIRE( lines == std::vector<std::string_view>{ "1, 2", "3", "4" } );
+    }
+
+    SECTION( "Parallel parsing gives the same result as serial parsing and stops at the first empty line" )
+    {
+        std::string text = "# header\n";
+        for( int i = 0; i < 1000; i++ )
+        {
+            text += fmt::format( "{}, {}\n", i, 0.5 * i );
+        }
+        text += "\nthis is not a number\n";
+
+        auto parse_line = []( std::string_view line, std::vector<double> & values )
+        { values.push_back( Seldon::parse_number<double>( line.substr( line.find( ',' ) + 1 ) ) ); };
+
+        for( size_t n_threads : { 1, 3, 8 } )
+        {
+            Seldon::Parallel::set_n_threads( n_threads );
+            auto chunks = Seldon::parse_lines_in_parallel<std::vector<double>>( text, parse_line, 100 );
+
+            std::vector<double> values{};
+            for( const auto & chunk : chunks )
+            {
+                values.insert( values.end(), chunk.begin(), chunk.end() );
+            }
+            REQUIRE( values.size() == 1000 );
+            for( size_t i = 0; i < values.size(); i++ )
+            {
+                REQUIRE( values[i] == 0.5 * double( i ) );
+            }
+
+            // A broken line before the first empty line is an error
+            REQUIRE_THROWS( Seldon::parse_lines_in_parallel<std::vector<double>>( "1, x\n" + text, parse_line, 100 ) );
+        }
+        Seldon::Parallel::set_n_threads( 0 );
+    }
+}
+
 TEST_CASE( "Test Hamming distance", "[util_hamming_dist]" )
 {
     std::vector<int> v1 = { 1, 1, 1, 0, 1 };
@@ -42,4 +107,66 @@ TEST_CASE( "Test Hamming distance", "[util_hamming_dist]" )
     auto dist = Seldon::hamming_distance( std::span( v1 ), std::span( v2 ) );
 
     REQUIRE( dist == 2 );
+}
+
+TEST_CASE( "Test the parallel chunking helpers", "[util_parallel]" )
+{
+    const size_t n         = 10000;
+    const size_t n_threads = 4;
+
+    // Every index is visited exactly once, in contiguous chunks
+    std::vector<int> visits( n, 0 );
+    Seldon::Parallel::for_each_chunk(
+        n,
+        [&]( size_t idx_begin, size_t idx_end, size_t )
+        {
+            for( size_t i = idx_begin; i < idx_end; i++ )
+            {
+                visits[i]++;
+            }
+        },
+        1000, n_threads );
+    REQUIRE( std::all_of( visits.begin(), visits.end(), []( int v ) { return v == 1; } ) );
+
+    REQUIRE( Seldon::Parallel::n_chunks( n, 1000, n_threads ) == n_threads );
+    REQUIRE( Seldon::Parallel::n_chunks( n, 5000, n_threads ) == 2 );
+    REQUIRE( Seldon::Parallel::n_chunks( 10, 1000, n_threads ) == 1 );
+
+    // Exceptions are propagated to the calling thread
+    auto throwing_func = []( size_t idx )
+    {
+        if( idx == 9000 )
+        {
+            throw std::runtime_error( "Test exception" );
+        }
+    };
+    REQUIRE_THROWS( Seldon::Parallel::for_each_index( n, throwing_func, 1000, n_threads ) );
+}
+
+TEST_CASE( "Test the memory usage breakdown", "[util_memory]" )
+{
+    using namespace Seldon;
+
+    std::vector<double> vec{};
+    vec.reserve( 10 );
+    vec.resize( 4 );
+    std::vector<std::vector<int>> nested( 3, std::vector<int>( 5 ) );
+    std::vector<int> empty{};
+
+    MemoryUsage usage{};
+    usage.add( "vec", vec );
+    usage.add( "empty", empty ); // Never allocated, so it is skipped
+
+    MemoryUsage usage_nested{};
+    usage_nested.add( "nested", nested );
+    usage.add( "inner", usage_nested );
+
+    REQUIRE( usage.entries.size() == 2 );
+    REQUIRE( usage.entries[0].bytes_used == 4 * sizeof( double ) );
+    REQUIRE( usage.entries[0].bytes_allocated == 10 * sizeof( double ) );
+    REQUIRE( usage.entries[1].name == "inner.nested" );
+    REQUIRE( usage.entries[1].bytes_used == 3 * sizeof( std::vector<int> ) + 15 * sizeof( int ) );
+    REQUIRE( usage.total_used() == usage.entries[0].bytes_used + usage.entries[1].bytes_used );
+    REQUIRE( usage.total_allocated() >= usage.total_used() );
+    REQUIRE( usage.to_string().find( "inner.nested" ) != std::string::npos );
 }
\ No newline at end of file